@@ -5,9 +5,10 @@
 
 #include "LandscapeLayerComponent.h"
 
-void ULandscapeHeightLayerData::ApplyToVertices(URuntimeLandscapeComponent* LandscapeComponent, const ULandscapeLayerComponent* LayerComponent, int32 VertexIndex,
-                                      float& OutHeightValue, FColor& VertexColor, float SmoothingFactor) const
+bool ULandscapeHeightLayerData::GetVertexEffect(const ULandscapeLayerComponent* LayerComponent,
+                                                FLandscapeLayerVertexEffect& OutEffect) const
 {
-	OutHeightValue = FMath::Lerp(HeightValue + LayerComponent->GetOwner()->GetActorLocation().Z, OutHeightValue,
-								 SmoothingFactor);
+	OutEffect.Type = ELandscapeLayerVertexEffect::Height;
+	OutEffect.Value = HeightValue + LayerComponent->GetOwner()->GetActorLocation().Z;
+	return true;
 }
@@ -3,14 +3,10 @@
 
 #include "LayerTypes/LandscapeHoleLayerData.h"
 
-#include "RuntimeLandscapeComponent.h"
-
-void ULandscapeHoleLayerData::ApplyToVertices(URuntimeLandscapeComponent* LandscapeComponent,
-                                    const ULandscapeLayerComponent* LayerComponent, int32 VertexIndex, float& OutHeightValue, FColor& OutVertexColor,
-                                    float SmoothingFactor) const
+bool ULandscapeHoleLayerData::GetVertexEffect(const ULandscapeLayerComponent* LayerComponent,
+                                              FLandscapeLayerVertexEffect& OutEffect) const
 {
-	if (SmoothingFactor < SmoothingValueThreshold)
-	{
-		LandscapeComponent->SetHoleFlagForVertex(VertexIndex, true);
-	}
+	OutEffect.Type = ELandscapeLayerVertexEffect::Hole;
+	OutEffect.Value = SmoothingValueThreshold;
+	return true;
 }
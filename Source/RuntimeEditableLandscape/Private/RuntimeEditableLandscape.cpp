@@ -2,10 +2,27 @@
 
 #include "RuntimeEditableLandscape.h"
 
+#include "RuntimeLandscapeCustomVersion.h"
+#include "Misc/QueuedThreadPool.h"
+#include "Serialization/CustomVersion.h"
+
 #define LOCTEXT_NAMESPACE "FRuntimeEditableLandscapeModule"
 
 DEFINE_LOG_CATEGORY(RuntimeEditableLandscape);
 
+const FGuid FRuntimeLandscapeCustomVersion::GUID(0x5B2C9E41, 0x7A3D4F86, 0x9E1B2C47, 0xD8A6F310);
+static FCustomVersionRegistration GRegisterRuntimeLandscapeCustomVersion(
+	FRuntimeLandscapeCustomVersion::GUID, FRuntimeLandscapeCustomVersion::LatestVersion, TEXT("RuntimeLandscapeVer"));
+
+static TAutoConsoleVariable<int32> CVarRebuildThreadCount(
+	TEXT("RuntimeLandscape.Rebuild.ThreadCount"),
+	0,
+	TEXT("The amount of threads that are shared by all runtime landscapes for rebuilding components.\n")
+	TEXT("0: Use the amount of worker threads of the platform. Only read when the thread pool is created."),
+	ECVF_ReadOnly);
+
+FQueuedThreadPool* FRuntimeEditableLandscapeModule::RebuildThreadPool = nullptr;
+
 void FRuntimeEditableLandscapeModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
@@ -15,6 +32,32 @@ void FRuntimeEditableLandscapeModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	if (RebuildThreadPool)
+	{
+		RebuildThreadPool->Destroy();
+		delete RebuildThreadPool;
+		RebuildThreadPool = nullptr;
+	}
+}
+
+FQueuedThreadPool* FRuntimeEditableLandscapeModule::GetRebuildThreadPool()
+{
+	check(IsInGameThread());
+
+	if (!RebuildThreadPool)
+	{
+		int32 NumThreadsInThreadPool = CVarRebuildThreadCount.GetValueOnGameThread();
+		if (NumThreadsInThreadPool <= 0)
+		{
+			NumThreadsInThreadPool = FPlatformMisc::NumberOfWorkerThreadsToSpawn();
+		}
+
+		RebuildThreadPool = FQueuedThreadPool::Allocate();
+		verify(RebuildThreadPool->Create(NumThreadsInThreadPool, 32 * 1024, TPri_Normal,
+			TEXT("Runtime Landscape rebuild thread")));
+	}
+
+	return RebuildThreadPool;
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -3,19 +3,99 @@
 
 #include "RuntimeLandscape.h"
 
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
 #include "ImageUtils.h"
 #include "Landscape.h"
 #include "LandscapeLayerComponent.h"
 #include "RuntimeEditableLandscape.h"
+#include "RuntimeLandscapeBakedData.h"
+#include "RuntimeLandscapeCollisionComponent.h"
 #include "RuntimeLandscapeComponent.h"
+#include "RuntimeLandscapeGrassManager.h"
+#include "RuntimeLandscapeMemoryUsage.h"
+#include "Algo/Find.h"
+#include "Async/MappedFileHandle.h"
+#include "Async/ParallelFor.h"
 #include "Chaos/HeightField.h"
 #include "Components/HierarchicalInstancedStaticMeshComponent.h"
 #include "Engine/Canvas.h"
+#include "HAL/PlatformFileManager.h"
 #include "Kismet/KismetMaterialLibrary.h"
 #include "Kismet/KismetRenderingLibrary.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopedSlowTask.h"
+#include "Runtime/Foliage/Public/InstancedFoliageActor.h"
 #include "LayerTypes/LandscapeGroundTypeLayerData.h"
 #include "LayerTypes/LandscapeLayerDataBase.h"
 #include "Threads/RuntimeLandscapeRebuildManager.h"
+#include "Threads/RuntimeLandscapeRebuildSubsystem.h"
+
+namespace RuntimeLandscapeHeightmap
+{
+	/**
+	 * The samples of a 16 bit heightmap
+	 * Raw heightmaps are memory mapped, PNGs are decoded into memory
+	 */
+	struct FHeightmapSource
+	{
+		TUniquePtr<IMappedFileHandle> MappedFile;
+		TUniquePtr<IMappedFileRegion> MappedRegion;
+		TArray64<uint8> DecodedData;
+		const uint16* Samples = nullptr;
+		FIntPoint Size = FIntPoint::ZeroValue;
+	};
+
+	bool Open(const FString& FilePath, FHeightmapSource& OutSource)
+	{
+		OutSource.MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FilePath));
+		if (OutSource.MappedFile.IsValid())
+		{
+			OutSource.MappedRegion.Reset(OutSource.MappedFile->MapRegion(0, OutSource.MappedFile->GetFileSize()));
+		}
+
+		if (!OutSource.MappedRegion.IsValid())
+		{
+			UE_LOG(RuntimeEditableLandscape, Warning, TEXT("Could not open heightmap %s."), *FilePath);
+			return false;
+		}
+
+		const uint8* FileData = OutSource.MappedRegion->GetMappedPtr();
+		const int64 FileSize = OutSource.MappedRegion->GetMappedSize();
+
+		if (FPaths::GetExtension(FilePath).Equals(TEXT("png"), ESearchCase::IgnoreCase))
+		{
+			IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(
+				TEXT("ImageWrapper"));
+			const TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+			if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(FileData, FileSize)
+				|| !ImageWrapper->GetRaw(ERGBFormat::Gray, 16, OutSource.DecodedData))
+			{
+				UE_LOG(RuntimeEditableLandscape, Warning, TEXT("Could not decode 16 bit heightmap %s."), *FilePath);
+				return false;
+			}
+
+			// the decoded samples are kept, the compressed file is not needed anymore
+			OutSource.Size = FIntPoint(ImageWrapper->GetWidth(), ImageWrapper->GetHeight());
+			OutSource.Samples = reinterpret_cast<const uint16*>(OutSource.DecodedData.GetData());
+			OutSource.MappedRegion.Reset();
+			OutSource.MappedFile.Reset();
+			return true;
+		}
+
+		// raw 16 bit samples, the heightmap has to be square
+		const int32 SideLength = FMath::RoundToInt32(FMath::Sqrt(static_cast<double>(FileSize / sizeof(uint16))));
+		if (static_cast<int64>(SideLength) * SideLength * sizeof(uint16) != FileSize)
+		{
+			UE_LOG(RuntimeEditableLandscape, Warning, TEXT("Raw heightmap %s is not square."), *FilePath);
+			return false;
+		}
+
+		OutSource.Size = FIntPoint(SideLength, SideLength);
+		OutSource.Samples = reinterpret_cast<const uint16*>(FileData);
+		return true;
+	}
+}
 
 TArray<FName> FRuntimeLandscapeGroundTypeLayerSet::GetLayerNames() const
 {
@@ -42,6 +122,7 @@ ARuntimeLandscape::ARuntimeLandscape() : Super()
 {
 	RootComponent = CreateDefaultSubobject<USceneComponent>("Root component");
 	RebuildManager = CreateDefaultSubobject<URuntimeLandscapeRebuildManager>("Rebuild manager");
+	GrassManager = CreateDefaultSubobject<URuntimeLandscapeGrassManager>("Grass manager");
 
 #if WITH_EDITORONLY_DATA
 	const ConstructorHelpers::FObjectFinder<UMaterial> DebugMaterialFinder(
@@ -53,11 +134,14 @@ ARuntimeLandscape::ARuntimeLandscape() : Super()
 #endif
 }
 
-void ARuntimeLandscape::AddLandscapeLayer(const ULandscapeLayerComponent* LayerToAdd)
+FRuntimeLandscapeEditHandle ARuntimeLandscape::AddLandscapeLayer(const ULandscapeLayerComponent* LayerToAdd)
 {
 	SCOPE_CYCLE_COUNTER(STAT_AddLandscapeLayer);
+	FRuntimeLandscapeEditHandle EditHandle;
 	if (ensure(LayerToAdd))
 	{
+		FRuntimeLandscapeEditScope EditScope(this);
+
 		// apply layer effects to whole landscape
 		for (const ULandscapeLayerDataBase* Layer : LayerToAdd->GetLayerData())
 		{
@@ -68,8 +152,50 @@ void ARuntimeLandscape::AddLandscapeLayer(const ULandscapeLayerComponent* LayerT
 		for (URuntimeLandscapeComponent* Component : GetComponentsInArea(LayerToAdd->GetBoundingBox()))
 		{
 			Component->AddLandscapeLayer(LayerToAdd);
+			EditHandle.AddComponent(Component);
+		}
+
+		QueueFoliageUpdate(LayerToAdd, EditHandle, false);
+	}
+
+	return EditHandle;
+}
+
+FRuntimeLandscapeEditHandle ARuntimeLandscape::MoveLandscapeLayer(const ULandscapeLayerComponent* Layer,
+                                                                  const FBox2D& PreviousBounds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AddLandscapeLayer);
+	FRuntimeLandscapeEditHandle EditHandle;
+	if (!ensure(Layer))
+	{
+		return EditHandle;
+	}
+
+	FRuntimeLandscapeEditScope EditScope(this);
+	for (const ULandscapeLayerDataBase* LayerData : Layer->GetLayerData())
+	{
+		LayerData->ApplyToLandscape(this, Layer);
+	}
+
+	// components that are covered before and after the move are only rebuilt once
+	const TArray<URuntimeLandscapeComponent*> CoveredComponents = GetComponentsInArea(Layer->GetBoundingBox());
+	for (URuntimeLandscapeComponent* Component : GetComponentsInArea(PreviousBounds))
+	{
+		if (!CoveredComponents.Contains(Component))
+		{
+			Component->RemoveLandscapeLayer(Layer);
+			EditHandle.AddComponent(Component);
 		}
 	}
+
+	for (URuntimeLandscapeComponent* Component : CoveredComponents)
+	{
+		Component->AddLandscapeLayer(Layer);
+		EditHandle.AddComponent(Component);
+	}
+
+	QueueFoliageUpdate(Layer, EditHandle, false);
+	return EditHandle;
 }
 
 void ARuntimeLandscape::DrawGroundType(const ULandscapeGroundTypeData* GroundType, ELayerShape Shape,
@@ -116,7 +242,70 @@ void ARuntimeLandscape::DrawGroundType(const ULandscapeGroundTypeData* GroundTyp
 		Canvas->K2_DrawMaterial(MaskBrushMaterial, ScreenPosition, BrushSize, FVector2D::Zero(),
 		                        FVector2D::UnitVector, Yaw);
 
-		UpdateVertexLayerWeights(*LayerSet);
+		if (IsEditing())
+		{
+			// reading back the render target is expensive, only do it once when the transaction ends
+			DirtyLayerSets.Add(UE_PTRDIFF_TO_INT32(LayerSet - GroundLayerSets.GetData()));
+		}
+		else
+		{
+			UpdateVertexLayerWeights(*LayerSet);
+		}
+	}
+}
+
+void ARuntimeLandscape::BeginEdit()
+{
+	check(IsInGameThread());
+	++EditDepth;
+}
+
+FRuntimeLandscapeEditHandle ARuntimeLandscape::EndEdit()
+{
+	FRuntimeLandscapeEditHandle EditHandle;
+	if (!ensureMsgf(EditDepth > 0, TEXT("EndEdit was called without matching BeginEdit on %s"), *GetName()))
+	{
+		return EditHandle;
+	}
+
+	--EditDepth;
+	if (EditDepth > 0)
+	{
+		return EditHandle;
+	}
+
+	for (const int32 LayerSetIndex : DirtyLayerSets)
+	{
+		if (GroundLayerSets.IsValidIndex(LayerSetIndex))
+		{
+			UpdateVertexLayerWeights(GroundLayerSets[LayerSetIndex]);
+		}
+	}
+
+	DirtyLayerSets.Empty();
+
+	for (const TWeakObjectPtr<URuntimeLandscapeComponent>& ComponentPtr : DirtyComponents)
+	{
+		if (URuntimeLandscapeComponent* Component = ComponentPtr.Get())
+		{
+			RebuildManager->QueueRebuild(Component);
+			EditHandle.AddComponent(Component);
+		}
+	}
+
+	DirtyComponents.Empty();
+	return EditHandle;
+}
+
+void ARuntimeLandscape::RequestComponentRebuild(URuntimeLandscapeComponent* Component)
+{
+	if (IsEditing())
+	{
+		DirtyComponents.Add(Component);
+	}
+	else
+	{
+		RebuildManager->QueueRebuild(Component);
 	}
 }
 
@@ -134,9 +323,10 @@ void ARuntimeLandscape::HandleLandscapeLayerOwnerDestroyed(AActor* DestroyedActo
 
 void ARuntimeLandscape::BakeLandscapeLayersAndDestroyLandscape()
 {
+	const bool bIsInitializedFromBakedData = InitializeFromBakedData();
 	if (ParentLandscape)
 	{
-		if (bBakeLayersOnBeginPlay)
+		if (bBakeLayersOnBeginPlay && !bIsInitializedFromBakedData)
 		{
 			BakeLandscapeLayers();
 		}
@@ -145,7 +335,11 @@ void ARuntimeLandscape::BakeLandscapeLayersAndDestroyLandscape()
 		ParentLandscape = nullptr;
 	}
 
-	OnLandscapeInitialized.Broadcast(this);
+	{
+		// layers that waited for the initialization are applied in one go
+		FRuntimeLandscapeEditScope EditScope(this);
+		OnLandscapeInitialized.Broadcast(this);
+	}
 	OnLandscapeInitialized.Clear(); // won't be needed anymore, free up the memory
 }
 
@@ -153,6 +347,8 @@ void ARuntimeLandscape::PostLoad()
 {
 	Super::PostLoad();
 
+	ConvertLegacyBaseHeights();
+
 	// Bake layers after editor load
 	if (ParentLandscape)
 	{
@@ -177,11 +373,281 @@ void ARuntimeLandscape::BeginPlay()
 	GetWorldTimerManager().SetTimerForNextTick(this, &ARuntimeLandscape::BakeLandscapeLayersAndDestroyLandscape);
 }
 
-void ARuntimeLandscape::RemoveLandscapeLayer(const ULandscapeLayerComponent* Layer)
+FRuntimeLandscapeEditHandle ARuntimeLandscape::RemoveLandscapeLayer(const ULandscapeLayerComponent* Layer)
 {
+	FRuntimeLandscapeEditHandle EditHandle;
+	FRuntimeLandscapeEditScope EditScope(this);
 	for (URuntimeLandscapeComponent* LandscapeComponent : LandscapeComponents)
 	{
-		LandscapeComponent->RemoveLandscapeLayer(Layer);
+		if (LandscapeComponent && LandscapeComponent->GetAffectingLayers().Contains(Layer))
+		{
+			LandscapeComponent->RemoveLandscapeLayer(Layer);
+			EditHandle.AddComponent(LandscapeComponent);
+		}
+	}
+
+	QueueFoliageUpdate(Layer, EditHandle, true);
+	return EditHandle;
+}
+
+void ARuntimeLandscape::QueueFoliageUpdate(const ULandscapeLayerComponent* Layer,
+                                           const FRuntimeLandscapeEditHandle& EditHandle, bool bIsRemoved)
+{
+	if (!FoliageActor || !ensure(Layer))
+	{
+		return;
+	}
+
+	FRuntimeLandscapeRemovedFoliage& Removed = RemovedFoliage.FindOrAdd(Layer);
+	Removed.QueuedUpdate = ++LastFoliageUpdate;
+
+	TOptional<FLandscapeLayerFootprint> Footprint;
+	if (!bIsRemoved)
+	{
+		Footprint = Layer->GetFootprint();
+	}
+
+	const FSimpleDelegate Callback = FSimpleDelegate::CreateWeakLambda(
+		this, [this, LayerKey = TObjectKey<ULandscapeLayerComponent>(Layer), Footprint, Update = LastFoliageUpdate]()
+		{
+			UpdateFoliageOfLayer(LayerKey, Footprint, Update);
+		});
+
+	// without the subsystem nothing is rebuilt asynchronously, i.e. while the world is torn down
+	URuntimeLandscapeRebuildSubsystem* RebuildSubsystem = UWorld::GetSubsystem<URuntimeLandscapeRebuildSubsystem>(
+		GetWorld());
+	if (RebuildSubsystem)
+	{
+		RebuildSubsystem->NotifyWhenComplete(EditHandle, Callback);
+	}
+	else
+	{
+		Callback.Execute();
+	}
+}
+
+void ARuntimeLandscape::UpdateFoliageOfLayer(TObjectKey<ULandscapeLayerComponent> LayerKey,
+                                             const TOptional<FLandscapeLayerFootprint>& Footprint, uint32 Update)
+{
+	// the entry is only dropped by the latest update, so a missing entry means this update is outdated
+	FRuntimeLandscapeRemovedFoliage* Removed = RemovedFoliage.Find(LayerKey);
+	if (!FoliageActor || !Removed || Update <= Removed->AppliedUpdate)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_UpdateLandscapeFoliage);
+	Removed->AppliedUpdate = Update;
+	const TOptional<FLandscapeLayerFootprint> PreviousFootprint = MoveTemp(Removed->Footprint);
+	Removed->Footprint = Footprint;
+
+	// instances inside the previous footprint are already removed, only the newly covered ones are left
+	if (Footprint.IsSet())
+	{
+		const FBox2D& LayerBounds = Footprint->BoundingBox;
+		for (const auto& FoliageInfo : FoliageActor->GetFoliageInfos())
+		{
+			UHierarchicalInstancedStaticMeshComponent* FoliageComp = FoliageInfo.Value->GetComponent();
+			if (!FoliageComp || FoliageComp->GetInstanceCount() == 0)
+			{
+				continue;
+			}
+
+			// the cluster tree only has to be searched in the bounds of the layer
+			const FBox FoliageBounds = FoliageComp->Bounds.GetBox();
+			const FBox QueryBox(FVector(LayerBounds.Min, FoliageBounds.Min.Z),
+			                    FVector(LayerBounds.Max, FoliageBounds.Max.Z));
+
+			TArray<int32> FoliageToRemove;
+			TArray<FTransform>* RemovedTransforms = nullptr;
+			for (int32 Instance : FoliageComp->GetInstancesOverlappingBox(QueryBox))
+			{
+				FTransform InstanceTransform;
+				FoliageComp->GetInstanceTransform(Instance, InstanceTransform, true);
+				const FVector2D InstanceLocation(InstanceTransform.GetLocation());
+				if (Footprint->IsInside(InstanceLocation)
+					&& !(PreviousFootprint.IsSet() && PreviousFootprint->IsInside(InstanceLocation)))
+				{
+					if (!RemovedTransforms)
+					{
+						RemovedTransforms = &Removed->Instances.FindOrAdd(FoliageComp);
+					}
+
+					FoliageToRemove.Add(Instance);
+					RemovedTransforms->Add(InstanceTransform);
+				}
+			}
+
+			if (!FoliageToRemove.IsEmpty())
+			{
+				FoliageComp->RemoveInstances(FoliageToRemove);
+			}
+		}
+	}
+
+	// the recorded instances outside of the new footprint are added again
+	TMap<TWeakObjectPtr<UHierarchicalInstancedStaticMeshComponent>, TArray<FTransform>> InstancesToRestore;
+	for (auto It = Removed->Instances.CreateIterator(); It; ++It)
+	{
+		TArray<FTransform>& Transforms = It->Value;
+		for (int32 i = Transforms.Num() - 1; i >= 0; --i)
+		{
+			if (!Footprint.IsSet() || !Footprint->IsInside(FVector2D(Transforms[i].GetLocation())))
+			{
+				InstancesToRestore.FindOrAdd(It->Key).Add(Transforms[i]);
+				Transforms.RemoveAtSwap(i);
+			}
+		}
+
+		if (Transforms.IsEmpty())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	if (!Footprint.IsSet() && Removed->QueuedUpdate == Update)
+	{
+		RemovedFoliage.Remove(LayerKey);
+	}
+
+	RestoreFoliage(LayerKey, InstancesToRestore);
+}
+
+void ARuntimeLandscape::RestoreFoliage(TObjectKey<ULandscapeLayerComponent> LayerKey,
+                                       const TMap<TWeakObjectPtr<UHierarchicalInstancedStaticMeshComponent>,
+                                                  TArray<FTransform>>& Instances)
+{
+	FBox2D RestoredArea(ForceInit);
+	for (const auto& FoliageInstances : Instances)
+	{
+		for (const FTransform& InstanceTransform : FoliageInstances.Value)
+		{
+			RestoredArea += FVector2D(InstanceTransform.GetLocation());
+		}
+	}
+
+	if (!RestoredArea.bIsValid)
+	{
+		return;
+	}
+
+	// instances inside the footprint of another layer stay removed, that layer restores them later
+	TSet<const ULandscapeLayerComponent*> OverlappingLayers;
+	for (const URuntimeLandscapeComponent* Component : GetComponentsInArea(RestoredArea))
+	{
+		for (const ULandscapeLayerComponent* OtherLayer : Component->GetAffectingLayers())
+		{
+			if (OtherLayer && TObjectKey<ULandscapeLayerComponent>(OtherLayer) != LayerKey)
+			{
+				OverlappingLayers.Add(OtherLayer);
+			}
+		}
+	}
+
+	for (const auto& FoliageInstances : Instances)
+	{
+		UHierarchicalInstancedStaticMeshComponent* FoliageComp = FoliageInstances.Key.Get();
+		if (!FoliageComp)
+		{
+			continue;
+		}
+
+		TArray<FTransform> InstancesToAdd;
+		InstancesToAdd.Reserve(FoliageInstances.Value.Num());
+		for (const FTransform& InstanceTransform : FoliageInstances.Value)
+		{
+			const FVector2D InstanceLocation = FVector2D(InstanceTransform.GetLocation());
+			const ULandscapeLayerComponent* const* CoveringLayer = Algo::FindByPredicate(
+				OverlappingLayers, [&InstanceLocation](const ULandscapeLayerComponent* OtherLayer)
+				{
+					return OtherLayer->IsInsideFootprint(InstanceLocation);
+				});
+
+			if (CoveringLayer)
+			{
+				RemovedFoliage.FindOrAdd(*CoveringLayer).Instances.FindOrAdd(FoliageComp).Add(InstanceTransform);
+			}
+			else
+			{
+				InstancesToAdd.Add(InstanceTransform);
+			}
+		}
+
+		if (!InstancesToAdd.IsEmpty())
+		{
+			FoliageComp->AddInstances(InstancesToAdd, false, true);
+		}
+	}
+}
+
+bool ARuntimeLandscape::HasPendingRebuilds() const
+{
+	for (const URuntimeLandscapeComponent* LandscapeComponent : LandscapeComponents)
+	{
+		if (LandscapeComponent && LandscapeComponent->HasPendingRebuild())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int32 ARuntimeLandscape::GetNumLODs() const
+{
+	// the coarsest LOD still needs at least a single quad per side
+	const int32 MinResolution = FMath::RoundToInt32(FMath::Min(ComponentResolution.X, ComponentResolution.Y));
+	const int32 MaxLOD = FMath::FloorLog2(FMath::Max(1, MinResolution));
+	return FMath::Min(LODScreenSizes.Num(), MaxLOD) + 1;
+}
+
+int32 ARuntimeLandscape::GetLODForScreenSize(float ScreenSize) const
+{
+	int32 LOD = 0;
+	while (LOD < GetNumLODs() - 1 && ScreenSize < LODScreenSizes[LOD])
+	{
+		LOD++;
+	}
+
+	return LOD;
+}
+
+int32 ARuntimeLandscape::GetCollisionStride() const
+{
+	// the samples have to stay a regular grid that includes the borders of the component
+	int32 MipLevel = FMath::Clamp(CollisionMipLevel, 0, 4);
+	while (MipLevel > 0 && ((VertexAmountPerComponent.X - 1) % (1 << MipLevel) != 0 ||
+		(VertexAmountPerComponent.Y - 1) % (1 << MipLevel) != 0))
+	{
+		MipLevel--;
+	}
+
+	return 1 << MipLevel;
+}
+
+void ARuntimeLandscape::GetMemoryUsage(FRuntimeLandscapeMemoryUsage& OutUsage) const
+{
+	for (URuntimeLandscapeComponent* LandscapeComponent : LandscapeComponents)
+	{
+		if (LandscapeComponent)
+		{
+			LandscapeComponent->GetMemoryUsage(OutUsage);
+		}
+	}
+
+	for (const FRuntimeLandscapeGroundTypeLayerSet& LayerSet : GroundLayerSets)
+	{
+		OutUsage.LayerWeights += LayerSet.VertexLayerWeights.GetAllocatedSize();
+	}
+
+	if (RebuildManager)
+	{
+		OutUsage.RebuildBuffers += RebuildManager->GetSpareBufferSize();
+	}
+
+	if (GrassManager)
+	{
+		OutUsage.Grass += GrassManager->GetGrassSize();
 	}
 }
 
@@ -233,6 +699,46 @@ TMap<const ULandscapeGroundTypeData*, float> ARuntimeLandscape::GetGroundTypeLay
 	return Result;
 }
 
+void ARuntimeLandscape::GetGroundTypeWeightsForComponent(int32 SectionIndex,
+                                                         TArray<FRuntimeLandscapeGroundTypeWeights>& OutWeights) const
+{
+	OutWeights.Empty(GroundLayerSets.Num());
+
+	for (const FRuntimeLandscapeGroundTypeLayerSet& LayerSet : GroundLayerSets)
+	{
+		if (!ensure(LayerSet.RenderTarget))
+		{
+			continue;
+		}
+
+		FRuntimeLandscapeGroundTypeWeights& Weights = OutWeights.AddDefaulted_GetRef();
+		for (int32 Channel = 0; Channel < LayerSet.GroundTypes.Num() && Channel < 4; ++Channel)
+		{
+			if (const ULandscapeGroundTypeData* GroundType = LayerSet.GroundTypes[Channel])
+			{
+				Weights.HasGroundType[Channel] = true;
+				Weights.Grass[Channel] = FRuntimeLandscapeGrassRule(GroundType->GrassTypeSettings);
+			}
+		}
+
+		Weights.VertexWeights.SetNumUninitialized(GetTotalVertexAmountPerComponent());
+		int32 VertexIndex = 0;
+		for (int32 Y = 0; Y < VertexAmountPerComponent.Y; ++Y)
+		{
+			for (int32 X = 0; X < VertexAmountPerComponent.X; ++X)
+			{
+				FIntVector2 VertexCoordinates;
+				GetVertexCoordinatesWithinLandscape(SectionIndex, X, Y, VertexCoordinates);
+				const int32 PixelIndex = LayerSet.GetPixelIndexForCoordinates(VertexCoordinates);
+				Weights.VertexWeights[VertexIndex] = LayerSet.VertexLayerWeights.IsValidIndex(PixelIndex)
+					                                     ? LayerSet.VertexLayerWeights[PixelIndex]
+					                                     : FColor(0, 0, 0, 0);
+				++VertexIndex;
+			}
+		}
+	}
+}
+
 TArray<URuntimeLandscapeComponent*> ARuntimeLandscape::GetComponentsInArea(const FBox2D& Area) const
 {
 	const FVector2D StartLocation = FVector2D(LandscapeComponents[0]->GetComponentLocation());
@@ -387,70 +893,386 @@ void ARuntimeLandscape::BakeLandscapeLayers()
 
 void ARuntimeLandscape::Rebuild()
 {
-	TArray<UHierarchicalInstancedStaticMeshComponent*> InstancedMeshes;
-	GetComponents(InstancedMeshes);
-	for (UHierarchicalInstancedStaticMeshComponent* InstancedMesh : InstancedMeshes)
-	{
-		InstancedMesh->DestroyComponent();
-	}
+	// every component is rebuilt once after all remembered layers are added again
+	FRuntimeLandscapeEditScope EditScope(this);
 
 	BakeLandscapeLayers();
 
 	// clean up old components but remember existing layers
 	TSet<TObjectPtr<const ULandscapeLayerComponent>> LandscapeLayers;
-	for (URuntimeLandscapeComponent* LandscapeComponent : LandscapeComponents)
-	{
-		if (LandscapeComponent)
-		{
-			LandscapeLayers.Append(LandscapeComponent->GetAffectingLayers().Array());
-			LandscapeComponent->DestroyComponent();
-		}
-	}
+	RemoveLandscapeComponents(LandscapeLayers);
 
 	BodyInstance = FBodyInstance();
 	BodyInstance.CopyBodyInstancePropertiesFrom(&ParentLandscape->BodyInstance);
 	bGenerateOverlapEvents = ParentLandscape->bGenerateOverlapEvents;
 
 	// create landscape components
-	LandscapeComponents.SetNumUninitialized(ParentLandscape->CollisionComponents.Num());
+	const TArray<TObjectPtr<ULandscapeHeightfieldCollisionComponent>>& CollisionComponents = ParentLandscape->
+		CollisionComponents;
+	LandscapeComponents.SetNumZeroed(CollisionComponents.Num());
 	const int32 VertexAmountPerSection = GetTotalVertexAmountPerComponent();
 
-	for (const ULandscapeHeightfieldCollisionComponent* LandscapeCollision : ParentLandscape->CollisionComponents)
+	// copy the heights of all collision components in parallel, straight from the quantized heightfield samples
+	TArray<TArray<float>> ComponentHeightValues;
+	ComponentHeightValues.SetNum(CollisionComponents.Num());
+	ParallelFor(CollisionComponents.Num(), [&](int32 CollisionIndex)
 	{
-		Chaos::FHeightFieldPtr HeightField = LandscapeCollision->HeightfieldRef->HeightfieldGeometry;
-		TArray<float> HeightValues = TArray<float>();
-		HeightValues.Reserve(VertexAmountPerSection);
+		const Chaos::FHeightFieldPtr& HeightField = CollisionComponents[CollisionIndex]->HeightfieldRef->
+			HeightfieldGeometry;
+		const auto& GeomData = HeightField->GeomData;
+		check(GeomData.Heights.Num() >= VertexAmountPerSection);
+
+		TArray<float>& HeightValues = ComponentHeightValues[CollisionIndex];
+		HeightValues.SetNumUninitialized(VertexAmountPerSection);
 		for (int32 i = 0; i < VertexAmountPerSection; i++)
 		{
-			HeightValues.Add(HeightField->GetHeight(i) * HeightScale);
+			// same as HeightField->GetHeight(i) without the per sample bounds check
+			HeightValues[i] = (GeomData.MinValue + GeomData.Heights[i] * GeomData.HeightPerUnit) * HeightScale;
 		}
+	});
 
-		URuntimeLandscapeComponent* LandscapeComponent = NewObject<URuntimeLandscapeComponent>(this);
-		LandscapeComponent->AttachToComponent(RootComponent, FAttachmentTransformRules::KeepRelativeTransform);
-		LandscapeComponent->SetWorldLocation(LandscapeCollision->GetComponentLocation());
-		LandscapeComponent->SetMaterial(0, LandscapeMaterial);
-		LandscapeComponent->SetGenerateOverlapEvents(bGenerateOverlapEvents);
-		LandscapeComponent->SetCastShadow(bCastShadow);
-		LandscapeComponent->SetAffectDistanceFieldLighting(bAffectDistanceFieldLighting);
+	UpdateBaseHeightRange(ComponentHeightValues);
 
-		LandscapeComponent->BodyInstance = FBodyInstance();
-		LandscapeComponent->BodyInstance.CopyBodyInstancePropertiesFrom(&ParentLandscape->BodyInstance);
-		LandscapeComponent->SetGenerateOverlapEvents(bGenerateOverlapEvents);
-		LandscapeComponent->SetCanEverAffectNavigation(bCanEverAffectNavigation);
+	FVector ParentOrigin;
+	FVector ParentExtent;
+	ParentLandscape->GetActorBounds(false, ParentOrigin, ParentExtent);
+	const FVector StartLocation = ParentOrigin - ParentExtent;
 
-		FVector ParentOrigin;
-		FVector ParentExtent;
-		ParentLandscape->GetActorBounds(false, ParentOrigin, ParentExtent);
+	for (int32 CollisionIndex = 0; CollisionIndex < CollisionComponents.Num(); CollisionIndex++)
+	{
+		const ULandscapeHeightfieldCollisionComponent* LandscapeCollision = CollisionComponents[CollisionIndex];
 
 		// calculate index by position for more efficient access later
-		const FVector StartLocation = ParentOrigin - ParentExtent;
-		const FVector ComponentLocation = LandscapeComponent->GetComponentLocation() - StartLocation;
+		const FVector ComponentLocation = LandscapeCollision->GetComponentLocation() - StartLocation;
 		int32 ComponentIndex = ComponentLocation.X / ComponentSize + ComponentLocation.Y / ComponentSize *
 			ComponentAmount.X;
 
-		LandscapeComponent->Initialize(ComponentIndex, HeightValues);
-		LandscapeComponent->RegisterComponent();
-		LandscapeComponents[ComponentIndex] = LandscapeComponent;
+		CreateLandscapeComponent(LandscapeCollision->GetComponentLocation(), ComponentIndex,
+		                         ComponentHeightValues[CollisionIndex]);
+	}
+
+	// add remembered layers
+	for (const ULandscapeLayerComponent* Layer : LandscapeLayers)
+	{
+		AddLandscapeLayer(Layer);
+	}
+}
+
+void ARuntimeLandscape::UpdateBaseHeightRange(const TArray<TArray<float>>& ComponentHeightValues)
+{
+	BaseHeightRange = FFloatInterval();
+	for (const TArray<float>& HeightValues : ComponentHeightValues)
+	{
+		if (!HeightValues.IsEmpty())
+		{
+			BaseHeightRange.Include(FMath::Min(HeightValues));
+			BaseHeightRange.Include(FMath::Max(HeightValues));
+		}
+	}
+}
+
+void ARuntimeLandscape::ConvertLegacyBaseHeights()
+{
+	TArray<TArray<float>> ComponentHeightValues;
+	for (const URuntimeLandscapeComponent* LandscapeComponent : LandscapeComponents)
+	{
+		if (LandscapeComponent && !LandscapeComponent->InitialHeightValues.IsEmpty())
+		{
+			ComponentHeightValues.Add(LandscapeComponent->InitialHeightValues);
+		}
+	}
+
+	if (ComponentHeightValues.IsEmpty())
+	{
+		return;
+	}
+
+	// the old heights already include the parent height
+	UpdateBaseHeightRange(ComponentHeightValues);
+	for (URuntimeLandscapeComponent* LandscapeComponent : LandscapeComponents)
+	{
+		if (LandscapeComponent && !LandscapeComponent->InitialHeightValues.IsEmpty())
+		{
+			LandscapeComponent->BaseHeights = MakeShared<FRuntimeLandscapeQuantizedHeights, ESPMode::ThreadSafe>();
+			LandscapeComponent->BaseHeights->Quantize(LandscapeComponent->InitialHeightValues, BaseHeightRange);
+			LandscapeComponent->InitialHeightValues.Empty();
+		}
+	}
+
+	BaseHeightRange.Min -= ParentHeight;
+	BaseHeightRange.Max -= ParentHeight;
+}
+
+URuntimeLandscapeComponent* ARuntimeLandscape::CreateLandscapeComponent(const FVector& WorldLocation,
+                                                                       int32 ComponentIndex,
+                                                                       const TArray<float>& HeightValues)
+{
+	URuntimeLandscapeComponent* LandscapeComponent = NewObject<URuntimeLandscapeComponent>(this);
+	LandscapeComponent->AttachToComponent(RootComponent, FAttachmentTransformRules::KeepRelativeTransform);
+	LandscapeComponent->SetWorldLocation(WorldLocation);
+	LandscapeComponent->SetMaterial(0, LandscapeMaterial);
+	LandscapeComponent->SetGenerateOverlapEvents(bGenerateOverlapEvents);
+	LandscapeComponent->SetCastShadow(bCastShadow);
+	LandscapeComponent->SetAffectDistanceFieldLighting(bAffectDistanceFieldLighting);
+
+	LandscapeComponent->BodyInstance = FBodyInstance();
+	LandscapeComponent->BodyInstance.CopyBodyInstancePropertiesFrom(&BodyInstance);
+	LandscapeComponent->SetGenerateOverlapEvents(bGenerateOverlapEvents);
+	LandscapeComponent->SetCanEverAffectNavigation(bCanEverAffectNavigation);
+
+	LandscapeComponent->Initialize(ComponentIndex, HeightValues);
+	LandscapeComponent->RegisterComponent();
+	LandscapeComponents[ComponentIndex] = LandscapeComponent;
+	return LandscapeComponent;
+}
+
+void ARuntimeLandscape::GatherBakedContents(FRuntimeLandscapeBakedContents& OutContents) const
+{
+	OutContents.VertexAmountPerComponent = VertexAmountPerComponent;
+
+	for (URuntimeLandscapeComponent* LandscapeComponent : LandscapeComponents)
+	{
+		FRuntimeLandscapeQuantizedHeights Heights;
+		if (!LandscapeComponent || !LandscapeComponent->CopyBaseHeights(Heights))
+		{
+			continue;
+		}
+
+		FRuntimeLandscapeBakedComponent& BakedComponent = OutContents.Components.AddDefaulted_GetRef();
+		BakedComponent.Index = LandscapeComponent->GetComponentIndex();
+		BakedComponent.RelativeLocation = LandscapeComponent->GetRelativeLocation();
+		BakedComponent.Heights = MoveTemp(Heights);
+		// the parent height is added again when the component is initialized
+		BakedComponent.Heights.Offset -= ParentHeight;
+	}
+
+	for (const FRuntimeLandscapeGroundTypeLayerSet& LayerSet : GroundLayerSets)
+	{
+		FRuntimeLandscapeBakedLayerSet& BakedLayerSet = OutContents.LayerSets.AddDefaulted_GetRef();
+		for (const ULandscapeGroundTypeData* GroundType : LayerSet.GroundTypes)
+		{
+			BakedLayerSet.GroundTypes.Add(FSoftObjectPath(GroundType));
+		}
+
+		BakedLayerSet.VertexLayerWeights = LayerSet.VertexLayerWeights;
+	}
+}
+
+bool ARuntimeLandscape::InitializeFromBakedData()
+{
+	FRuntimeLandscapeBakedContents Contents;
+	if (!BakedData || !BakedData->Load(Contents))
+	{
+		return false;
+	}
+
+	if (Contents.VertexAmountPerComponent != VertexAmountPerComponent)
+	{
+		UE_LOG(RuntimeEditableLandscape, Warning,
+		       TEXT("Baked data of %s does not match the landscape resolution and is ignored."), *GetName());
+		return false;
+	}
+
+	for (int32 i = 0; i < Contents.LayerSets.Num() && i < GroundLayerSets.Num(); i++)
+	{
+		FRuntimeLandscapeGroundTypeLayerSet& LayerSet = GroundLayerSets[i];
+		FRuntimeLandscapeBakedLayerSet& BakedLayerSet = Contents.LayerSets[i];
+
+		TArray<FSoftObjectPath> GroundTypes;
+		for (const ULandscapeGroundTypeData* GroundType : LayerSet.GroundTypes)
+		{
+			GroundTypes.Add(FSoftObjectPath(GroundType));
+		}
+
+		if (GroundTypes == BakedLayerSet.GroundTypes)
+		{
+			LayerSet.VertexLayerWeights = MoveTemp(BakedLayerSet.VertexLayerWeights);
+		}
+		else
+		{
+			UE_LOG(RuntimeEditableLandscape, Warning,
+			       TEXT("Baked ground type layer set %i of %s is outdated, bake the landscape again."), i,
+			       *GetName());
+		}
+	}
+
+	// components that are saved with the level are already up to date, only restore the missing ones
+	FRuntimeLandscapeEditScope EditScope(this);
+	LandscapeComponents.SetNumZeroed(FMath::Max(LandscapeComponents.Num(),
+	                                            FMath::RoundToInt32(ComponentAmount.X * ComponentAmount.Y)));
+	TArray<const FRuntimeLandscapeBakedComponent*> MissingComponents;
+	TArray<TArray<float>> ComponentHeightValues;
+	for (const FRuntimeLandscapeBakedComponent& BakedComponent : Contents.Components)
+	{
+		if (LandscapeComponents.IsValidIndex(BakedComponent.Index) && !LandscapeComponents[BakedComponent.Index])
+		{
+			MissingComponents.Add(&BakedComponent);
+			BakedComponent.Heights.Dequantize(ComponentHeightValues.AddDefaulted_GetRef());
+		}
+	}
+
+	// existing components keep their range, the missing ones are quantized with it so the borders still match
+	if (!BaseHeightRange.IsValid() || MissingComponents.Num() == Contents.Components.Num())
+	{
+		UpdateBaseHeightRange(ComponentHeightValues);
+	}
+
+	for (int32 i = 0; i < MissingComponents.Num(); i++)
+	{
+		CreateLandscapeComponent(GetActorTransform().TransformPosition(MissingComponents[i]->RelativeLocation),
+		                         MissingComponents[i]->Index, ComponentHeightValues[i]);
+	}
+
+	BakedData->UnloadPayload();
+	return true;
+}
+
+void ARuntimeLandscape::BakeToBinaryCache()
+{
+#if WITH_EDITORONLY_DATA
+	BakeLandscapeLayers();
+
+	if (!BakedData)
+	{
+		Modify();
+		BakedData = NewObject<URuntimeLandscapeBakedData>(this, TEXT("BakedData"));
+	}
+
+	FRuntimeLandscapeBakedContents Contents;
+	GatherBakedContents(Contents);
+	BakedData->Store(Contents);
+
+	UE_LOG(RuntimeEditableLandscape, Display, TEXT("Baked %i components and %i layer sets of %s."),
+	       Contents.Components.Num(), Contents.LayerSets.Num(), *GetName());
+#endif
+}
+
+void ARuntimeLandscape::InitializeDimensions(const FIntPoint& InMeshResolution, int32 ComponentSizeQuads,
+                                             float InQuadSideLength)
+{
+	MeshResolution = FVector2D(InMeshResolution);
+	QuadSideLength = InQuadSideLength;
+	LandscapeSize = MeshResolution * QuadSideLength;
+	ComponentSize = ComponentSizeQuads * QuadSideLength;
+	AreaPerSquare = FMath::Square(QuadSideLength);
+	ComponentAmount = FVector2D(MeshResolution.X / ComponentSizeQuads, MeshResolution.Y / ComponentSizeQuads);
+	ComponentResolution = MeshResolution / ComponentAmount;
+
+	VertexAmountPerComponent.X = MeshResolution.X / ComponentAmount.X + 1;
+	VertexAmountPerComponent.Y = MeshResolution.Y / ComponentAmount.Y + 1;
+}
+
+void ARuntimeLandscape::RemoveLandscapeComponents(TSet<TObjectPtr<const ULandscapeLayerComponent>>& OutLandscapeLayers)
+{
+	TArray<UHierarchicalInstancedStaticMeshComponent*> InstancedMeshes;
+	GetComponents(InstancedMeshes);
+	for (UHierarchicalInstancedStaticMeshComponent* InstancedMesh : InstancedMeshes)
+	{
+		InstancedMesh->DestroyComponent();
+	}
+
+	for (URuntimeLandscapeComponent* LandscapeComponent : LandscapeComponents)
+	{
+		if (LandscapeComponent)
+		{
+			OutLandscapeLayers.Append(LandscapeComponent->GetAffectingLayers().Array());
+			LandscapeComponent->DestroyComponent();
+		}
+	}
+
+	LandscapeComponents.Empty();
+}
+
+void ARuntimeLandscape::StartInitialRebuild()
+{
+	URuntimeLandscapeRebuildSubsystem* RebuildSubsystem = UWorld::GetSubsystem<URuntimeLandscapeRebuildSubsystem>(
+		GetWorld());
+	if (!RebuildSubsystem || RebuildSubsystem->StartBatchRebuild(this) == 0)
+	{
+		return;
+	}
+
+#if WITH_EDITOR
+	// in the editor, wait for all components and show the progress, instead of letting them pop in one by one
+	if (!GetWorld()->IsGameWorld())
+	{
+		FScopedSlowTask SlowTask(1.0f, NSLOCTEXT("RuntimeLandscape", "RebuildLandscape",
+		                                         "Rebuilding runtime landscape..."));
+		SlowTask.MakeDialog();
+
+		float ReportedProgress = 0.0f;
+		RebuildSubsystem->WaitForBatchRebuild([&SlowTask, &ReportedProgress](float Progress)
+		{
+			SlowTask.EnterProgressFrame(Progress - ReportedProgress);
+			ReportedProgress = Progress;
+		});
+	}
+#endif
+}
+
+bool ARuntimeLandscape::InitializeFromHeightmap(const FString& FilePath, int32 ComponentSizeQuads,
+                                                const FVector& Scale)
+{
+	RuntimeLandscapeHeightmap::FHeightmapSource Heightmap;
+	if (!RuntimeLandscapeHeightmap::Open(FilePath, Heightmap))
+	{
+		return false;
+	}
+
+	const FIntPoint Resolution = Heightmap.Size - FIntPoint(1, 1);
+	const bool bIsValidComponentSize = ComponentSizeQuads > 0 && FMath::Square(ComponentSizeQuads + 1) <=
+		URuntimeLandscapeRebuildManager::MaxVerticesPerComponent;
+	if (!bIsValidComponentSize || Resolution.X <= 0 || Resolution.Y <= 0
+		|| Resolution.X % ComponentSizeQuads != 0 || Resolution.Y % ComponentSizeQuads != 0)
+	{
+		UE_LOG(RuntimeEditableLandscape, Warning,
+		       TEXT("Heightmap %s with %ix%i samples can not be split into components of %i quads."), *FilePath,
+		       Heightmap.Size.X, Heightmap.Size.Y, ComponentSizeQuads);
+		return false;
+	}
+
+	// same height encoding as ALandscape, 0x8000 is the actor location
+	HeightScale = Scale.Z / 128.0f;
+	ParentHeight = GetActorLocation().Z;
+	InitializeDimensions(Resolution, ComponentSizeQuads, Scale.X);
+
+	FRuntimeLandscapeEditScope EditScope(this);
+	TSet<TObjectPtr<const ULandscapeLayerComponent>> LandscapeLayers;
+	RemoveLandscapeComponents(LandscapeLayers);
+
+	const int32 ComponentAmountX = FMath::RoundToInt32(ComponentAmount.X);
+	const int32 ComponentCount = ComponentAmountX * FMath::RoundToInt32(ComponentAmount.Y);
+	LandscapeComponents.SetNumZeroed(ComponentCount);
+
+	// copy the samples of every component in parallel, the heightmap is only paged in as far as it is read
+	TArray<TArray<float>> ComponentHeightValues;
+	ComponentHeightValues.SetNum(ComponentCount);
+	ParallelFor(ComponentCount, [&](int32 ComponentIndex)
+	{
+		const int32 FirstSampleX = ComponentIndex % ComponentAmountX * ComponentSizeQuads;
+		const int32 FirstSampleY = ComponentIndex / ComponentAmountX * ComponentSizeQuads;
+
+		TArray<float>& HeightValues = ComponentHeightValues[ComponentIndex];
+		HeightValues.SetNumUninitialized(GetTotalVertexAmountPerComponent());
+		for (int32 Y = 0; Y < VertexAmountPerComponent.Y; Y++)
+		{
+			const uint16* SampleRow = Heightmap.Samples + static_cast<int64>(FirstSampleY + Y) * Heightmap.Size.X +
+				FirstSampleX;
+			for (int32 X = 0; X < VertexAmountPerComponent.X; X++)
+			{
+				HeightValues[Y * VertexAmountPerComponent.X + X] = (SampleRow[X] - 32768.0f) * HeightScale;
+			}
+		}
+	});
+
+	UpdateBaseHeightRange(ComponentHeightValues);
+
+	for (int32 ComponentIndex = 0; ComponentIndex < ComponentCount; ComponentIndex++)
+	{
+		const FVector ComponentLocation = GetActorLocation() + FVector(ComponentIndex % ComponentAmountX * ComponentSize,
+		                                                              ComponentIndex / ComponentAmountX * ComponentSize,
+		                                                              0.0f);
+		CreateLandscapeComponent(ComponentLocation, ComponentIndex, ComponentHeightValues[ComponentIndex]);
 	}
 
 	// add remembered layers
@@ -458,6 +1280,19 @@ void ARuntimeLandscape::Rebuild()
 	{
 		AddLandscapeLayer(Layer);
 	}
+
+	UE_LOG(RuntimeEditableLandscape, Display, TEXT("Imported heightmap %s into %i components of %s."), *FilePath,
+	       ComponentCount, *GetName());
+	return true;
+}
+
+void ARuntimeLandscape::ImportHeightmap()
+{
+	if (InitializeFromHeightmap(HeightmapImportSettings.File.FilePath, HeightmapImportSettings.ComponentSizeQuads,
+	                            HeightmapImportSettings.Scale))
+	{
+		StartInitialRebuild();
+	}
 }
 
 void ARuntimeLandscape::InitializeFromLandscape()
@@ -477,23 +1312,14 @@ void ARuntimeLandscape::InitializeFromLandscape()
 	ParentHeight = ParentLandscape->GetActorLocation().Z;
 
 	const FIntRect Rect = ParentLandscape->GetBoundingRect();
-	MeshResolution.X = Rect.Max.X - Rect.Min.X;
-	MeshResolution.Y = Rect.Max.Y - Rect.Min.Y;
 	FVector ParentOrigin;
 	FVector ParentExtent;
 	ParentLandscape->GetActorBounds(false, ParentOrigin, ParentExtent);
-	LandscapeSize = FVector2D(ParentExtent * FVector(2.0f));
-	const int32 ComponentSizeQuads = ParentLandscape->ComponentSizeQuads;
-	QuadSideLength = ParentExtent.X * 2 / MeshResolution.X;
-	ComponentSize = ComponentSizeQuads * QuadSideLength;
-	AreaPerSquare = FMath::Square(QuadSideLength);
-	ComponentAmount = FVector2D(MeshResolution.X / ComponentSizeQuads, MeshResolution.Y / ComponentSizeQuads);
-	ComponentResolution = MeshResolution / ComponentAmount;
-
-	VertexAmountPerComponent.X = MeshResolution.X / ComponentAmount.X + 1;
-	VertexAmountPerComponent.Y = MeshResolution.Y / ComponentAmount.Y + 1;
+	InitializeDimensions(FIntPoint(Rect.Max.X - Rect.Min.X, Rect.Max.Y - Rect.Min.Y),
+	                     ParentLandscape->ComponentSizeQuads, ParentExtent.X * 2 / (Rect.Max.X - Rect.Min.X));
 
 	Rebuild();
+	StartInitialRebuild();
 #endif
 }
 
@@ -552,6 +1378,13 @@ void ARuntimeLandscape::PostEditChangeProperty(FPropertyChangedEvent& PropertyCh
 			Component->BodyInstance = FBodyInstance();
 			Component->BodyInstance.CopyBodyInstancePropertiesFrom(&BodyInstance);
 			Component->SetGenerateOverlapEvents(bGenerateOverlapEvents);
+			if (URuntimeLandscapeCollisionComponent* CollisionComponent = Component->CollisionComponent)
+			{
+				CollisionComponent->BodyInstance = FBodyInstance();
+				CollisionComponent->BodyInstance.CopyBodyInstancePropertiesFrom(&BodyInstance);
+				CollisionComponent->SetGenerateOverlapEvents(bGenerateOverlapEvents);
+				CollisionComponent->RecreatePhysicsState();
+			}
 		}
 	}
 }
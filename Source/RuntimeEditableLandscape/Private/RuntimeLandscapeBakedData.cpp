@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RuntimeLandscapeBakedData.h"
+
+#include "RuntimeEditableLandscape.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace RuntimeLandscapeBakedData
+{
+	/** Identifies the payload, "RTLB" */
+	constexpr uint32 Magic = 0x524C5442;
+}
+
+FArchive& operator<<(FArchive& Ar, FRuntimeLandscapeBakedComponent& Component)
+{
+	Ar << Component.Index;
+	Ar << Component.RelativeLocation;
+	Ar << Component.Heights;
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FRuntimeLandscapeBakedLayerSet& LayerSet)
+{
+	Ar << LayerSet.GroundTypes;
+	LayerSet.VertexLayerWeights.BulkSerialize(Ar);
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FRuntimeLandscapeBakedContents& Contents)
+{
+	Ar << Contents.VertexAmountPerComponent.X;
+	Ar << Contents.VertexAmountPerComponent.Y;
+	Ar << Contents.Components;
+	Ar << Contents.LayerSets;
+	return Ar;
+}
+
+void URuntimeLandscapeBakedData::Store(FRuntimeLandscapeBakedContents& Contents)
+{
+	TArray<uint8> Payload;
+	FMemoryWriter Writer(Payload);
+
+	uint32 Magic = RuntimeLandscapeBakedData::Magic;
+	int32 Version = DataVersion;
+	Writer << Magic;
+	Writer << Version;
+	Writer << Contents;
+
+	BulkData.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(BulkData.Realloc(Payload.Num()), Payload.GetData(), Payload.Num());
+	BulkData.Unlock();
+
+	// keep the payload out of the package header, it is only loaded on demand
+	BulkData.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload);
+	MarkPackageDirty();
+}
+
+bool URuntimeLandscapeBakedData::Load(FRuntimeLandscapeBakedContents& OutContents) const
+{
+	if (!HasData())
+	{
+		return false;
+	}
+
+	const uint8* Payload = static_cast<const uint8*>(BulkData.LockReadOnly());
+	FMemoryReaderView Reader(MakeArrayView(Payload, BulkData.GetBulkDataSize()));
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	Reader << Magic;
+	Reader << Version;
+
+	const bool bIsValid = Magic == RuntimeLandscapeBakedData::Magic && Version == DataVersion;
+	if (bIsValid)
+	{
+		Reader << OutContents;
+	}
+	else
+	{
+		UE_LOG(RuntimeEditableLandscape, Warning,
+		       TEXT("Baked data %s is outdated (version %i, expected %i) and is ignored. Bake the landscape again."),
+		       *GetPathName(), Version, DataVersion);
+	}
+
+	BulkData.Unlock();
+	return bIsValid && !Reader.IsError();
+}
+
+void URuntimeLandscapeBakedData::UnloadPayload()
+{
+#if !WITH_EDITOR
+	// the editor needs the payload to save the package again
+	BulkData.RemoveBulkData();
+#endif
+}
+
+void URuntimeLandscapeBakedData::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+	BulkData.Serialize(Ar, this);
+}
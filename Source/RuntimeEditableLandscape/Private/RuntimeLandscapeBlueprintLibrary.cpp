@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RuntimeLandscapeBlueprintLibrary.h"
+
+#include "LandscapeLayerComponent.h"
+#include "LatentActions.h"
+#include "Engine/Engine.h"
+#include "Engine/LatentActionManager.h"
+
+/**
+ * Finishes the latent node once the edit is complete
+ */
+class FWaitForLandscapeEditAction : public FPendingLatentAction
+{
+public:
+	FWaitForLandscapeEditAction(const FRuntimeLandscapeEditHandle& InEditHandle, const FLatentActionInfo& LatentInfo)
+		: EditHandle(InEditHandle), ExecutionFunction(LatentInfo.ExecutionFunction), OutputLink(LatentInfo.Linkage),
+		  CallbackTarget(LatentInfo.CallbackTarget)
+	{
+	}
+
+	virtual void UpdateOperation(FLatentResponse& Response) override
+	{
+		Response.FinishAndTriggerIf(EditHandle.IsComplete(), ExecutionFunction, OutputLink, CallbackTarget);
+	}
+
+#if WITH_EDITOR
+	virtual FString GetDescription() const override
+	{
+		return TEXT("Waiting for the landscape edit to be applied");
+	}
+#endif
+
+private:
+	FRuntimeLandscapeEditHandle EditHandle;
+	FName ExecutionFunction;
+	int32 OutputLink;
+	FWeakObjectPtr CallbackTarget;
+};
+
+FRuntimeLandscapeEditHandle URuntimeLandscapeBlueprintLibrary::ApplyLandscapeLayer(ULandscapeLayerComponent* Layer)
+{
+	if (ensure(Layer))
+	{
+		return Layer->ApplyToLandscape();
+	}
+
+	return FRuntimeLandscapeEditHandle();
+}
+
+bool URuntimeLandscapeBlueprintLibrary::IsLandscapeEditComplete(const FRuntimeLandscapeEditHandle& EditHandle)
+{
+	return EditHandle.IsComplete();
+}
+
+void URuntimeLandscapeBlueprintLibrary::WaitForLandscapeEdit(const UObject* WorldContextObject,
+                                                            const FRuntimeLandscapeEditHandle& EditHandle,
+                                                            FLatentActionInfo LatentInfo)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	if (!World)
+	{
+		return;
+	}
+
+	FLatentActionManager& LatentActionManager = World->GetLatentActionManager();
+	if (!LatentActionManager.FindExistingAction<FWaitForLandscapeEditAction>(LatentInfo.CallbackTarget,
+	                                                                        LatentInfo.UUID))
+	{
+		LatentActionManager.AddNewAction(LatentInfo.CallbackTarget, LatentInfo.UUID,
+		                                 new FWaitForLandscapeEditAction(EditHandle, LatentInfo));
+	}
+}
@@ -0,0 +1,318 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RuntimeLandscapeCollisionComponent.h"
+
+#include "AI/Navigation/NavigableGeometryExport.h"
+#include "Chaos/ImplicitObjectTransformed.h"
+#include "Chaos/ShapeInstance.h"
+#include "Physics/PhysicsFiltering.h"
+#include "Physics/PhysicsInterfaceCore.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+
+namespace RuntimeLandscapeCollision
+{
+	/** Wraps the heightfield, a new wrapper makes the physics scene pick up edited heights */
+	Chaos::FImplicitObjectPtr MakeGeometry(const Chaos::FHeightFieldPtr& HeightField)
+	{
+		return MakeImplicitObjectPtr<Chaos::TImplicitObjectTransformed<Chaos::FReal, 3>>(
+			HeightField, Chaos::FRigidTransform3::Identity);
+	}
+}
+
+Chaos::FHeightFieldPtr FRuntimeLandscapeCollisionData::BuildHeightField() const
+{
+	TArray<Chaos::FReal> RealHeights;
+	RealHeights.SetNumUninitialized(Heights.Num());
+	for (int32 i = 0; i < Heights.Num(); i++)
+	{
+		RealHeights[i] = Heights[i];
+	}
+
+	TArray<uint8> MaterialIndicesCopy = MaterialIndices;
+	return new Chaos::FHeightField(MoveTemp(RealHeights), MoveTemp(MaterialIndicesCopy), NumSamples.Y, NumSamples.X,
+	                               SampleScale);
+}
+
+URuntimeLandscapeCollisionComponent::URuntimeLandscapeCollisionComponent() : Super()
+{
+	bHasCustomNavigableGeometry = EHasCustomNavigableGeometry::Yes;
+}
+
+void URuntimeLandscapeCollisionComponent::ApplyCollisionData(const FRuntimeLandscapeCollisionDataPtr& NewData,
+                                                             const FRuntimeLandscapeCollisionDataPtr& PreviousData)
+{
+	if (!ensure(NewData.IsValid()))
+	{
+		return;
+	}
+
+	if (NewData->HeightField.IsValid())
+	{
+		HeightField = NewData->HeightField;
+		RecreatePhysicsState();
+	}
+	else if (HeightField.IsValid() && CollisionData.IsValid() && CollisionData == PreviousData)
+	{
+		EditHeightField(*NewData);
+	}
+	else
+	{
+		// the heightfield changed since the data was generated, should be rare
+		HeightField = NewData->BuildHeightField();
+		RecreatePhysicsState();
+	}
+
+	CollisionData = NewData;
+	UpdateBounds();
+}
+
+void URuntimeLandscapeCollisionComponent::ClearHeightField()
+{
+	HeightField = nullptr;
+	CollisionData.Reset();
+	RecreatePhysicsState();
+	UpdateBounds();
+}
+
+SIZE_T URuntimeLandscapeCollisionComponent::GetHeightFieldSize() const
+{
+	if (!CollisionData.IsValid())
+	{
+		return 0;
+	}
+
+	// the heightfield stores 16 bit heights and its own copy of the material indices
+	return CollisionData->GetAllocatedSize() + CollisionData->Heights.Num() * sizeof(uint16) +
+		CollisionData->MaterialIndices.Num();
+}
+
+void URuntimeLandscapeCollisionComponent::EditHeightField(const FRuntimeLandscapeCollisionData& NewData)
+{
+	const FIntRect& DirtyRect = NewData.DirtyRect;
+	const int32 NumRows = DirtyRect.Max.Y - DirtyRect.Min.Y + 1;
+	const int32 NumColumns = DirtyRect.Max.X - DirtyRect.Min.X + 1;
+
+	TArray<Chaos::FReal> DirtyHeights;
+	DirtyHeights.Reserve(NumRows * NumColumns);
+	for (int32 Y = DirtyRect.Min.Y; Y <= DirtyRect.Max.Y; Y++)
+	{
+		for (int32 X = DirtyRect.Min.X; X <= DirtyRect.Max.X; X++)
+		{
+			DirtyHeights.Add(NewData.Heights[Y * NewData.NumSamples.X + X]);
+		}
+	}
+
+	FPhysicsActorHandle& ActorHandle = BodyInstance.GetPhysicsActorHandle();
+	if (!FPhysicsInterface::IsValid(ActorHandle))
+	{
+		HeightField->EditHeights(DirtyHeights, DirtyRect.Min.Y, DirtyRect.Min.X, NumRows, NumColumns);
+		return;
+	}
+
+	FPhysicsCommand::ExecuteWrite(ActorHandle, [&](const FPhysicsActorHandle& Actor)
+	{
+		HeightField->EditHeights(DirtyHeights, DirtyRect.Min.Y, DirtyRect.Min.X, NumRows, NumColumns);
+
+		// the new geometry updates the bounds of the body and its entry in the acceleration structure
+		Actor->GetGameThreadAPI().SetGeometry(RuntimeLandscapeCollision::MakeGeometry(HeightField));
+		if (FPhysScene* PhysScene = GetWorld()->GetPhysicsScene())
+		{
+			PhysScene->UpdateActorInAccelerationStructure(Actor);
+		}
+	});
+}
+
+FBoxSphereBounds URuntimeLandscapeCollisionComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	if (!CollisionData.IsValid() || !CollisionData->LocalBox.IsValid)
+	{
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.0f);
+	}
+
+	return FBoxSphereBounds(CollisionData->LocalBox.TransformBy(LocalToWorld));
+}
+
+bool URuntimeLandscapeCollisionComponent::DoCustomNavigableGeometryExport(FNavigableGeometryExport& GeomExport) const
+{
+	if (HeightField.IsValid())
+	{
+		// the scale is already part of the heightfield
+		GeomExport.ExportChaosHeightField(HeightField.GetReference(),
+		                                  FTransform(GetComponentRotation(), GetComponentLocation()));
+	}
+
+	// there is no other collision to export
+	return false;
+}
+
+bool URuntimeLandscapeCollisionComponent::GetNavigationDirtyArea(FBox& OutArea) const
+{
+	if (!CollisionData.IsValid() || !RegisteredNavigationBounds.IsValid ||
+		!RegisteredNavigationBounds.IsInsideOrOn(Bounds.GetBox()))
+	{
+		return false;
+	}
+
+	// the quads around the changed samples are affected too
+	const FIntRect& DirtyRect = CollisionData->DirtyRect;
+	const FVector& Scale = CollisionData->SampleScale;
+	const FBox LocalArea(FVector((DirtyRect.Min.X - 1) * Scale.X, (DirtyRect.Min.Y - 1) * Scale.Y, 0.0f),
+	                     FVector((DirtyRect.Max.X + 1) * Scale.X, (DirtyRect.Max.Y + 1) * Scale.Y, 0.0f));
+	OutArea = LocalArea.TransformBy(FTransform(GetComponentRotation(), GetComponentLocation()));
+	// the registered bounds contain the previous heights as well
+	OutArea.Min.Z = RegisteredNavigationBounds.Min.Z;
+	OutArea.Max.Z = RegisteredNavigationBounds.Max.Z;
+	return true;
+}
+
+void URuntimeLandscapeCollisionComponent::PrepareGeometryExportSync()
+{
+	// the slices are gathered by the navigation threads, so they must not see the data change in between
+	NavigationCollisionData = CollisionData;
+}
+
+void URuntimeLandscapeCollisionComponent::GatherGeometrySlice(FNavigableGeometryExport& GeomExport,
+                                                              const FBox& SliceBox) const
+{
+	const FRuntimeLandscapeCollisionData* Data = NavigationCollisionData.Get();
+	if (!Data)
+	{
+		return;
+	}
+
+	// the scale is already part of the samples
+	const FTransform LocalToWorld(GetComponentRotation(), GetComponentLocation());
+	const FBox LocalSlice = SliceBox.InverseTransformBy(LocalToWorld);
+	const FVector& Scale = Data->SampleScale;
+	const int32 MinX = FMath::Clamp(FMath::FloorToInt32(LocalSlice.Min.X / Scale.X), 0, Data->NumSamples.X - 1);
+	const int32 MaxX = FMath::Clamp(FMath::CeilToInt32(LocalSlice.Max.X / Scale.X), 0, Data->NumSamples.X - 1);
+	const int32 MinY = FMath::Clamp(FMath::FloorToInt32(LocalSlice.Min.Y / Scale.Y), 0, Data->NumSamples.Y - 1);
+	const int32 MaxY = FMath::Clamp(FMath::CeilToInt32(LocalSlice.Max.Y / Scale.Y), 0, Data->NumSamples.Y - 1);
+	if (MinX >= MaxX || MinY >= MaxY)
+	{
+		return;
+	}
+
+	const int32 RowLength = MaxX - MinX + 1;
+	TArray<FVector> Vertices;
+	Vertices.Reserve(RowLength * (MaxY - MinY + 1));
+	for (int32 Y = MinY; Y <= MaxY; Y++)
+	{
+		for (int32 X = MinX; X <= MaxX; X++)
+		{
+			Vertices.Add(FVector(X * Scale.X, Y * Scale.Y, Data->Heights[Y * Data->NumSamples.X + X] * Scale.Z));
+		}
+	}
+
+	// same triangulation as the mesh, holes are skipped
+	TArray<int32> Indices;
+	Indices.Reserve((RowLength - 1) * (MaxY - MinY) * 6);
+	for (int32 Y = MinY; Y < MaxY; Y++)
+	{
+		for (int32 X = MinX; X < MaxX; X++)
+		{
+			const uint8 MaterialIndex = Data->MaterialIndices[Y * (Data->NumSamples.X - 1) + X];
+			if (MaterialIndex == FRuntimeLandscapeCollisionData::HoleMaterialIndex)
+			{
+				continue;
+			}
+
+			const int32 T1 = (Y - MinY) * RowLength + X - MinX;
+			const int32 T2 = T1 + RowLength;
+			const int32 T3 = T1 + 1;
+			Indices.Append({T1, T2, T3, T3, T2, T2 + 1});
+		}
+	}
+
+	GeomExport.ExportCustomMesh(Vertices.GetData(), Vertices.Num(), Indices.GetData(), Indices.Num(), LocalToWorld);
+}
+
+bool URuntimeLandscapeCollisionComponent::ShouldCreatePhysicsState() const
+{
+	return HeightField.IsValid() && Super::ShouldCreatePhysicsState();
+}
+
+void URuntimeLandscapeCollisionComponent::OnCreatePhysicsState()
+{
+	// skip the primitive component, it would create the body from a body setup
+	USceneComponent::OnCreatePhysicsState();
+
+	FPhysScene* PhysScene = GetWorld()->GetPhysicsScene();
+	if (!PhysScene || BodyInstance.IsValidBodyInstance())
+	{
+		return;
+	}
+
+	FActorCreationParams Params;
+	Params.InitialTM = FTransform(GetComponentRotation(), GetComponentLocation());
+	Params.bQueryOnly = false;
+	Params.bStatic = true;
+	Params.Scene = PhysScene;
+
+	FPhysicsActorHandle ActorHandle;
+	FPhysicsInterface::CreateActor(Params, ActorHandle);
+	Chaos::FRigidBodyHandle_External& Body = ActorHandle->GetGameThreadAPI();
+
+	FCollisionFilterData QueryFilterData;
+	FCollisionFilterData SimFilterData;
+	CreateShapeFilterData(BodyInstance.GetObjectType(), BodyInstance.GetMaskFilter(), GetOwner()->GetUniqueID(),
+	                      BodyInstance.GetResponseToChannels(), GetUniqueID(), 0, QueryFilterData, SimFilterData,
+	                      true, false, true);
+	// the heightfield is used for simple and complex collision
+	QueryFilterData.Word3 |= EPDF_SimpleCollision | EPDF_ComplexCollision;
+	SimFilterData.Word3 |= EPDF_SimpleCollision | EPDF_ComplexCollision;
+
+	Chaos::FImplicitObjectPtr Geometry = RuntimeLandscapeCollision::MakeGeometry(HeightField);
+	TUniquePtr<Chaos::FPerShapeData> Shape = Chaos::FShapeInstanceProxy::Make(0, Geometry);
+	Shape->SetQueryData(QueryFilterData);
+	Shape->SetSimData(SimFilterData);
+	if (UPhysicalMaterial* PhysicalMaterial = BodyInstance.GetSimplePhysicalMaterial())
+	{
+		Shape->SetMaterial(PhysicalMaterial->GetPhysicsMaterial());
+	}
+	Shape->UpdateShapeBounds(Params.InitialTM);
+
+	Chaos::FShapesArray Shapes;
+	Shapes.Emplace(MoveTemp(Shape));
+	Body.SetGeometry(Geometry);
+	Body.MergeShapesArray(MoveTemp(Shapes));
+
+	BodyInstance.PhysicsUserData = FPhysicsUserData(&BodyInstance);
+	BodyInstance.OwnerComponent = this;
+	BodyInstance.ActorHandle = ActorHandle;
+	Body.SetUserData(&BodyInstance.PhysicsUserData);
+
+	TArray<FPhysicsActorHandle> Actors = {ActorHandle};
+	FPhysicsCommand::ExecuteWrite(PhysScene, [&]()
+	{
+		PhysScene->AddActorsToScene_AssumesLocked(Actors, true);
+	});
+	PhysScene->AddToComponentMaps(this, ActorHandle);
+	if (BodyInstance.bNotifyRigidBodyCollision)
+	{
+		PhysScene->RegisterForCollisionEvents(this);
+	}
+}
+
+void URuntimeLandscapeCollisionComponent::OnDestroyPhysicsState()
+{
+	// unregister before the body is released by the primitive component
+	if (FPhysScene* PhysScene = GetWorld() ? GetWorld()->GetPhysicsScene() : nullptr)
+	{
+		FPhysicsActorHandle& ActorHandle = BodyInstance.GetPhysicsActorHandle();
+		if (FPhysicsInterface::IsValid(ActorHandle))
+		{
+			PhysScene->RemoveFromComponentMaps(ActorHandle);
+		}
+
+		if (BodyInstance.bNotifyRigidBodyCollision)
+		{
+			PhysScene->UnRegisterForCollisionEvents(this);
+		}
+	}
+
+	Super::OnDestroyPhysicsState();
+}
@@ -5,13 +5,25 @@
 
 #include "LandscapeGrassType.h"
 #include "LandscapeLayerComponent.h"
-#include "NavigationSystem.h"
 #include "RuntimeEditableLandscape.h"
 #include "RuntimeLandscape.h"
+#include "RuntimeLandscapeCollisionComponent.h"
+#include "RuntimeLandscapeCustomVersion.h"
+#include "RuntimeLandscapeGrassManager.h"
+#include "RuntimeLandscapeMemoryUsage.h"
 #include "LayerTypes/LandscapeHoleLayerData.h"
 #include "LayerTypes/LandscapeLayerDataBase.h"
-#include "Runtime/Foliage/Public/InstancedFoliageActor.h"
+#include "PhysicsEngine/PhysicsSettings.h"
+#include "Threads/GenerateLODWorker.h"
 #include "Threads/RuntimeLandscapeRebuildManager.h"
+#include "Threads/RuntimeLandscapeRebuildSubsystem.h"
+
+URuntimeLandscapeComponent::URuntimeLandscapeComponent() : Super()
+{
+	RebuildGeneration = MakeShared<FRuntimeLandscapeRebuildGeneration, ESPMode::ThreadSafe>();
+	// cook the collision off the game thread, the previous collision stays active until the new one is ready
+	bUseAsyncCooking = true;
+}
 
 void URuntimeLandscapeComponent::AddLandscapeLayer(const ULandscapeLayerComponent* Layer)
 {
@@ -24,147 +36,319 @@ void URuntimeLandscapeComponent::Initialize(int32 ComponentIndex, const TArray<f
 	ParentLandscape = Cast<ARuntimeLandscape>(GetOwner());
 	if (ensure(ParentLandscape))
 	{
-		InitialHeightValues.SetNumUninitialized(HeightValuesInitial.Num());
-		for (int32 i = 0; i < HeightValuesInitial.Num(); i++)
-		{
-			InitialHeightValues[i] = HeightValuesInitial[i] + ParentLandscape->GetParentHeight();
-		}
+		BaseHeights = MakeShared<FRuntimeLandscapeQuantizedHeights, ESPMode::ThreadSafe>();
+		BaseHeights->Quantize(HeightValuesInitial, ParentLandscape->GetBaseHeightRange(),
+		                      ParentLandscape->GetParentHeight());
 
 		Index = ComponentIndex;
 		Rebuild();
 	}
 }
 
-FVector2D URuntimeLandscapeComponent::GetRelativeVertexLocation(int32 VertexIndex) const
+void URuntimeLandscapeComponent::RequestRebuild()
 {
-	FIntVector2 Coordinates;
-	ParentLandscape->GetVertexCoordinatesWithinComponent(VertexIndex, Coordinates);
-	return FVector2D(Coordinates.X * ParentLandscape->GetQuadSideLength(),
-	                 Coordinates.Y * ParentLandscape->GetQuadSideLength());
+	if (IsInGameThread())
+	{
+		Rebuild();
+		return;
+	}
+
+	// supersede rebuilds that are still in flight right away, the generation is thread safe
+	RebuildGeneration->Increment();
+	if (URuntimeLandscapeRebuildSubsystem* RebuildSubsystem = UWorld::GetSubsystem<
+		URuntimeLandscapeRebuildSubsystem>(GetWorld()))
+	{
+		RebuildSubsystem->QueueRebuildFromAnyThread(this);
+	}
 }
 
-UHierarchicalInstancedStaticMeshComponent* URuntimeLandscapeComponent::FindOrAddGrassMesh(const FGrassVariety& Variety)
+void URuntimeLandscapeComponent::Serialize(FArchive& Ar)
 {
-	UHierarchicalInstancedStaticMeshComponent** Mesh = GrassMeshes.FindByPredicate(
-		[Variety](const UHierarchicalInstancedStaticMeshComponent* Current)
-		{
-			return Current->GetStaticMesh() == Variety.GrassMesh;
-		});
+	Super::Serialize(Ar);
+
+	Ar.UsingCustomVersion(FRuntimeLandscapeCustomVersion::GUID);
+	if (Ar.IsLoading() && Ar.CustomVer(FRuntimeLandscapeCustomVersion::GUID) <
+		FRuntimeLandscapeCustomVersion::QuantizedBaseHeights)
+	{
+		// older data only has the float heights, they are converted in ARuntimeLandscape::PostLoad
+		return;
+	}
 
-	if (Mesh)
+	bool bHasBaseHeights = BaseHeights.IsValid() || IsCold();
+	Ar << bHasBaseHeights;
+	if (!bHasBaseHeights)
 	{
-		return *Mesh;
+		return;
 	}
 
-	UHierarchicalInstancedStaticMeshComponent* InstancedStaticMesh = NewObject<
-		UHierarchicalInstancedStaticMeshComponent>(GetOwner());
-	InstancedStaticMesh->SetStaticMesh(Variety.GrassMesh);
-	InstancedStaticMesh->AttachToComponent(this, FAttachmentTransformRules::SnapToTargetIncludingScale);
-	InstancedStaticMesh->RegisterComponent();
-	InstancedStaticMesh->SetCullDistances(Variety.GetStartCullDistance(), Variety.GetEndCullDistance());
-	InstancedStaticMesh->SetCastShadow(Variety.bCastDynamicShadow);
-	InstancedStaticMesh->SetCastContactShadow(Variety.bCastContactShadow);
+	// cold components are saved as they are, saving must not change their state
+	bool bIsCold = IsCold();
+	if (Ar.CustomVer(FRuntimeLandscapeCustomVersion::GUID) >= FRuntimeLandscapeCustomVersion::CompressedBaseHeights)
+	{
+		Ar << bIsCold;
+	}
 
-	GrassMeshes.Add(InstancedStaticMesh);
-	return InstancedStaticMesh;
+	if (bIsCold)
+	{
+		if (Ar.IsLoading())
+		{
+			// jobs that still reference the previous heights keep them alive until they are done
+			BaseHeights.Reset();
+		}
+
+		Ar << CompressedBaseHeights;
+		return;
+	}
+
+	if (Ar.IsLoading())
+	{
+		// never modify the heights in place, running rebuilds may still read them
+		BaseHeights = MakeShared<FRuntimeLandscapeQuantizedHeights, ESPMode::ThreadSafe>();
+		CompressedBaseHeights.Reset();
+	}
+
+	Ar << *BaseHeights;
 }
 
-void URuntimeLandscapeComponent::Rebuild()
+const FRuntimeLandscapeQuantizedHeightsPtr& URuntimeLandscapeComponent::GetBaseHeights()
 {
-	ParentLandscape->GetRebuildManager()->QueueRebuild(this);
+	if (IsCold())
+	{
+		FRuntimeLandscapeQuantizedHeightsPtr RestoredHeights = MakeShared<
+			FRuntimeLandscapeQuantizedHeights, ESPMode::ThreadSafe>();
+		if (ensure(RestoredHeights->Decompress(CompressedBaseHeights)))
+		{
+			BaseHeights = RestoredHeights;
+		}
+
+		CompressedBaseHeights.Reset();
+	}
+
+	return BaseHeights;
 }
 
-void URuntimeLandscapeComponent::ApplyDataFromLayers(TArray<float>& OutHeightValues, TArray<FColor>& OutVertexColors)
+bool URuntimeLandscapeComponent::CopyBaseHeights(FRuntimeLandscapeQuantizedHeights& OutHeights) const
 {
-	check(OutHeightValues.Num() == InitialHeightValues.Num());
+	if (IsCold())
+	{
+		return OutHeights.Decompress(CompressedBaseHeights);
+	}
 
-	VerticesInHole.Empty();
-	OutVertexColors.Init(FColor::White, InitialHeightValues.Num());
-	for (const ULandscapeLayerComponent* Layer : AffectingLayers)
+	if (!BaseHeights.IsValid())
 	{
-		for (int32 i = 0; i < InitialHeightValues.Num(); i++)
-		{
-			Layer->ApplyLayerData(i, this, OutHeightValues[i],
-			                      OutVertexColors[i]);
-		}
+		return false;
 	}
+
+	OutHeights = *BaseHeights;
+	return true;
 }
 
-void URuntimeLandscapeComponent::UpdateNavigation()
+bool URuntimeLandscapeComponent::CompressBaseHeights()
 {
-	if (ParentLandscape->bUpdateNavigation)
+	if (IsCold() || !BaseHeights.IsValid() || !BaseHeights->Compress(CompressedBaseHeights))
 	{
-		if (const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
-		{
-			NavSys->UpdateComponentInNavOctree(*this);
-		}
+		return IsCold();
 	}
+
+	// jobs that still reference the heights keep them alive until they are done
+	BaseHeights.Reset();
+	return true;
+}
+
+uint32 URuntimeLandscapeComponent::GetRebuildGeneration() const
+{
+	return RebuildGeneration->Get();
 }
 
-void URuntimeLandscapeComponent::RemoveFoliageAffectedByLayer() const
+void URuntimeLandscapeComponent::GetMemoryUsage(FRuntimeLandscapeMemoryUsage& OutUsage)
 {
-	const AInstancedFoliageActor* Foliage = ParentLandscape->GetFoliageActor();
-	if (!Foliage)
+	OutUsage.BaseHeights += CompressedBaseHeights.Data.GetAllocatedSize();
+	if (BaseHeights.IsValid())
 	{
-		return;
+		OutUsage.BaseHeights += BaseHeights->Samples.GetAllocatedSize();
 	}
 
-	FBox MyBounds = GetLocalBounds().GetBox();
-	MyBounds = MyBounds.MoveTo(GetComponentLocation() + MyBounds.GetExtent());
-	MyBounds = MyBounds.ExpandBy(FVector(0.0f, 0.0f, 10000.0f));
+	OutUsage.Holes += VerticesInHole.GetAllocatedSize();
+	for (int32 i = 0; i < GetNumSections(); i++)
+	{
+		const FProcMeshSection* Section = GetProcMeshSection(i);
+		OutUsage.MeshSections += Section->ProcVertexBuffer.GetAllocatedSize()
+			+ Section->ProcIndexBuffer.GetAllocatedSize();
+	}
+	OutUsage.MeshSections += FullResolutionVertices.GetAllocatedSize() + FullResolutionIndices.GetAllocatedSize();
 
-	for (const auto& FoliageInfo : Foliage->GetFoliageInfos())
+	if (CollisionComponent)
 	{
-		TArray<int32> Instances;
-		UHierarchicalInstancedStaticMeshComponent* FoliageComp = FoliageInfo.Value->GetComponent();
+		OutUsage.Collision += CollisionComponent->GetHeightFieldSize();
+	}
+}
 
-		TArray<int32> FoliageToRemove;
-		for (int32 Instance : FoliageComp->GetInstancesOverlappingBox(MyBounds))
-		{
-			FTransform InstanceTransform;
-			FoliageComp->GetInstanceTransform(Instance, InstanceTransform, true);
-			FVector2D InstanceLocation = FVector2D(InstanceTransform.GetLocation());
+bool URuntimeLandscapeComponent::HasGrass() const
+{
+	return ParentLandscape && ParentLandscape->GetGrassManager()->HasGrass(this);
+}
 
-			for (const ULandscapeLayerComponent* Layer : AffectingLayers)
-			{
-				if (Layer->IsAffectedByLayer(InstanceLocation))
-				{
-					FoliageToRemove.Add(Instance);
-					break;
-				}
-			}
-		}
+SIZE_T URuntimeLandscapeComponent::EvictGrass()
+{
+	if (!ParentLandscape)
+	{
+		return 0;
+	}
+
+	EvictedGrassSize = ParentLandscape->GetGrassManager()->RemoveComponentGrass(this);
+	bIsGrassEvicted = true;
+	return EvictedGrassSize;
+}
+
+FVector2D URuntimeLandscapeComponent::GetRelativeVertexLocation(int32 VertexIndex) const
+{
+	FIntVector2 Coordinates;
+	ParentLandscape->GetVertexCoordinatesWithinComponent(VertexIndex, Coordinates);
+	return FVector2D(Coordinates.X * ParentLandscape->GetQuadSideLength(),
+	                 Coordinates.Y * ParentLandscape->GetQuadSideLength());
+}
+
+void URuntimeLandscapeComponent::StreamIn()
+{
+	if (!bIsStreamedIn)
+	{
+		bIsStreamedIn = true;
+		Rebuild();
+	}
+}
+
+void URuntimeLandscapeComponent::StreamOut()
+{
+	if (!bIsStreamedIn)
+	{
+		return;
+	}
+
+	bIsStreamedIn = false;
+	// drop rebuilds that are queued or in flight, there is nothing left to wait for
+	RebuildGeneration->Increment();
+	AppliedGeneration = GetRebuildGeneration();
 
-		FoliageComp->RemoveInstances(FoliageToRemove);
+	CancelLODBuild();
+	ClearAllMeshSections();
+	if (CollisionComponent)
+	{
+		CollisionComponent->ClearHeightField();
 	}
+	FullResolutionVertices.Empty();
+	FullResolutionIndices.Empty();
+	NumFullResolutionVertices = 0;
+	NumFullResolutionIndices = 0;
+	CurrentLOD = 0;
+	EvictGrass();
+	CompressBaseHeights();
+	UpdateNavigation();
 }
 
-void URuntimeLandscapeComponent::FinishRebuild(const FRuntimeLandscapeRebuildBuffer& RebuildBuffer)
+void URuntimeLandscapeComponent::Rebuild()
 {
-	// TODO: Reuse stuff instead of recreating everything
-	// clean up old stuff
-	for (UHierarchicalInstancedStaticMeshComponent* GrassMesh : GrassMeshes)
+	if (!bIsStreamedIn)
 	{
-		if (ensure(GrassMesh))
-		{
-			GrassMesh->DestroyComponent();
-		}
+		// the layers are only stored, they are applied once the component is streamed in again
+		RebuildGeneration->Increment();
+		AppliedGeneration = GetRebuildGeneration();
+		return;
+	}
+
+	// supersede rebuilds that are still in flight for this component
+	RebuildGeneration->Increment();
+	ParentLandscape->RequestComponentRebuild(this);
+}
+
+void URuntimeLandscapeComponent::UpdateNavigation(const FRuntimeLandscapeRebuildJob* Job)
+{
+	URuntimeLandscapeRebuildSubsystem* RebuildSubsystem = UWorld::GetSubsystem<URuntimeLandscapeRebuildSubsystem>(
+		GetWorld());
+	if (!ParentLandscape->bUpdateNavigation || !RebuildSubsystem)
+	{
+		return;
+	}
+
+	if (!CollisionComponent)
+	{
+		// the triangle mesh collision is gathered right away, so the whole component has to be updated
+		RebuildSubsystem->QueueNavigationUpdate(this);
+		return;
+	}
+
+	if (Job && !Job->Collision.IsValid())
+	{
+		// the collision is unchanged
+		return;
 	}
 
-	GrassMeshes.Empty();
+	// the heightfield is gathered lazily, so only the area that changed has to be rebuilt
+	FBox DirtyArea;
+	if (Job && CollisionComponent->GetNavigationDirtyArea(DirtyArea))
+	{
+		RebuildSubsystem->QueueNavigationDirtyArea(DirtyArea);
+	}
+	else
+	{
+		CollisionComponent->MarkNavigationBoundsRegistered();
+		RebuildSubsystem->QueueNavigationUpdate(CollisionComponent);
+	}
+}
 
-	for (const FLandscapeAdditionalData& AdditionalData : RebuildBuffer.AdditionalData)
+bool URuntimeLandscapeComponent::ApplyRebuildStep(FRuntimeLandscapeRebuildJob& Job,
+                                                  FRuntimeLandscapeApplyState& ApplyState)
+{
+	switch (ApplyState.Step)
 	{
-		for (const auto& GrassData : AdditionalData.GrassData)
+	case RLAS_Mesh:
+		ApplyMesh(Job);
+		ApplyState.Step = RLAS_GatherGrass;
+		break;
+	case RLAS_GatherGrass:
+		GatherGrass(Job.Buffer, ApplyState);
+		bIsGrassEvicted = false;
+		EvictedGrassSize = 0;
+		ApplyState.Step = ApplyState.GrassPerMesh.IsEmpty() ? RLAS_Collision : RLAS_Grass;
+		break;
+	case RLAS_Grass:
 		{
-			if (GrassData.Value.InstanceTransformsRelative.IsEmpty() == false)
+			const FLandscapeGrassVertexData& GrassData = ApplyState.GrassPerMesh[ApplyState.GrassMeshIndex];
+			ParentLandscape->GetGrassManager()->SetComponentGrass(this, GrassData.GrassVariety,
+			                                                      GrassData.InstanceTransformsRelative);
+
+			++ApplyState.GrassMeshIndex;
+			if (!ApplyState.GrassPerMesh.IsValidIndex(ApplyState.GrassMeshIndex))
 			{
-				UHierarchicalInstancedStaticMeshComponent* GrassMesh = FindOrAddGrassMesh(GrassData.Value.GrassVariety);
-				GrassMesh->AddInstances(GrassData.Value.InstanceTransformsRelative, false);
+				ApplyState.Step = RLAS_Collision;
 			}
 		}
+		break;
+	case RLAS_Collision:
+		ApplyHeightFieldCollision(Job);
+		ApplyState.Step = RLAS_Navigation;
+		break;
+	case RLAS_Navigation:
+		UpdateNavigation(&Job);
+		ApplyState.Step = RLAS_Done;
+
+		UE_LOG(RuntimeEditableLandscape, Display, TEXT("	Finished rebuilding Landscape component %s %i..."),
+		       *GetOwner()->GetName(), Index);
+		break;
+	default:
+		checkNoEntry();
 	}
 
+	return ApplyState.Step == RLAS_Done;
+}
+
+void URuntimeLandscapeComponent::ApplyMesh(FRuntimeLandscapeRebuildJob& Job)
+{
+	const FRuntimeLandscapeRebuildBuffer& RebuildBuffer = Job.Buffer;
+	// a LOD build in flight still reads the previous full resolution and holes
+	CancelLODBuild();
+	// the holes are generated together with the mesh, the LODs are built from them
+	VerticesInHole = Job.VerticesInHole;
+
 #if WITH_EDITORONLY_DATA
 
 	FIntVector2 SectionCoordinates;
@@ -211,39 +395,263 @@ void URuntimeLandscapeComponent::FinishRebuild(const FRuntimeLandscapeRebuildBuf
 	}
 #endif
 
-	TArray<FColor> VertexColors;
-	VertexColors.Init(FColor::White, RebuildBuffer.VerticesRelative.Num());
-
-	TArray<int32> Triangles;
-	if (VerticesInHole.IsEmpty())
+	// the rebuild threads already filled the arrays, the previous ones are reused by the next rebuild
+	if (GetNumSections() == 0)
 	{
-		Triangles = RebuildBuffer.Triangles;
+		// i.e. the first rebuild or after streaming in, an empty section is added so the data is swapped in place
+		SetProcMeshSection(0, FProcMeshSection());
+	}
+	FProcMeshSection& Section = *GetProcMeshSection(0);
+	// the rebuild threads also generated the mesh of the LOD, including the skirts
+	CurrentLOD = Job.LOD;
+	NumFullResolutionVertices = RebuildBuffer.VerticesRelative.Num();
+	NumFullResolutionIndices = RebuildBuffer.NumFullResolutionIndices;
+	if (CurrentLOD == 0)
+	{
+		Swap(Section.ProcVertexBuffer, Job.Buffer.SectionVertices);
+		Swap(Section.ProcIndexBuffer, Job.Buffer.SectionIndices);
+		FullResolutionVertices.Empty();
+		FullResolutionIndices.Empty();
 	}
 	else
 	{
-		Triangles = ParentLandscape->GetRebuildManager()->GenerateTriangleArray(&VerticesInHole);
+		// a lower LOD is shown, the full resolution is only kept on the CPU
+		Swap(FullResolutionVertices, Job.Buffer.SectionVertices);
+		Swap(FullResolutionIndices, Job.Buffer.SectionIndices);
+		Swap(Section.ProcVertexBuffer, Job.Buffer.LODVertices);
+		Swap(Section.ProcIndexBuffer, Job.Buffer.LODIndices);
 	}
 
-	CreateMeshSection(0, RebuildBuffer.VerticesRelative, Triangles, RebuildBuffer.Normals, RebuildBuffer.UV0Coords,
-	                  RebuildBuffer.UV1Coords, RebuildBuffer.UV0Coords, RebuildBuffer.UV0Coords, VertexColors,
-	                  RebuildBuffer.Tangents, ParentLandscape->bUpdateCollision);
+	// the bounds of the component are only updated here, they include the skirts of all LODs
+	Section.SectionLocalBox = RebuildBuffer.SectionLocalBox;
+	Section.SectionLocalBox.Min.Z -= Job.SkirtDepth;
+	// the triangle collision always uses the full resolution, see GetPhysicsTriMeshData
+	Section.bEnableCollision = false;
+	Section.bSectionVisible = true;
 
-	RemoveFoliageAffectedByLayer();
-	UpdateNavigation();
+	// assigning the section to itself copies nothing, but updates the bounds and collision and the render state
+	SetProcMeshSection(0, Section);
+}
+
+void URuntimeLandscapeComponent::ApplyHeightFieldCollision(const FRuntimeLandscapeRebuildJob& Job)
+{
+	if (!Job.bBuildCollision)
+	{
+		if (CollisionComponent)
+		{
+			CollisionComponent->DestroyComponent();
+			CollisionComponent = nullptr;
+		}
+		return;
+	}
 
-	UE_LOG(RuntimeEditableLandscape, Display, TEXT("	Finished rebuilding Landscape component %s %i..."),
-	       *GetOwner()->GetName(), Index);
+	if (!CollisionComponent)
+	{
+		CollisionComponent = NewObject<URuntimeLandscapeCollisionComponent>(GetOwner());
+		CollisionComponent->AttachToComponent(this, FAttachmentTransformRules::SnapToTargetIncludingScale);
+		CollisionComponent->BodyInstance.CopyBodyInstancePropertiesFrom(&BodyInstance);
+		CollisionComponent->SetGenerateOverlapEvents(GetGenerateOverlapEvents());
+		CollisionComponent->SetCanEverAffectNavigation(CanEverAffectNavigation());
+		CollisionComponent->RegisterComponent();
+	}
+
+	// no collision is generated if the current one is up to date
+	if (Job.Collision.IsValid())
+	{
+		CollisionComponent->ApplyCollisionData(Job.Collision, Job.PreviousCollision);
+	}
+
+	// without a previous heightfield the rebuild threads always generate one, i.e. for the initial rebuild
+	ensureMsgf(CollisionComponent->HasHeightField(),
+	           TEXT("Rebuild of Landscape component %s %i did not produce a heightfield collision"),
+	           *GetOwner()->GetName(), Index);
 }
 
-void URuntimeLandscapeComponent::DestroyComponent(bool bPromoteChildren)
+bool URuntimeLandscapeComponent::RequestLOD(int32 LOD)
 {
-	for (UHierarchicalInstancedStaticMeshComponent* GrassMesh : GrassMeshes)
+	FProcMeshSection* Section = GetProcMeshSection(0);
+	const FIntVector2& VertexAmount = ParentLandscape->GetVertexAmountPerComponent();
+	if (LOD == CurrentLOD || LODBuild.IsValid() || !Section
+		|| NumFullResolutionVertices != VertexAmount.X * VertexAmount.Y)
 	{
-		if (GrassMesh)
+		return false;
+	}
+
+	if (LOD == 0)
+	{
+		// the skirts of LOD 0 are kept behind the full resolution, so it is only moved back into the section
+		Section->ProcVertexBuffer = MoveTemp(FullResolutionVertices);
+		Section->ProcIndexBuffer = MoveTemp(FullResolutionIndices);
+		CurrentLOD = 0;
+		MarkRenderStateDirty();
+		return true;
+	}
+
+	LODBuild = MakeShared<FRuntimeLandscapeLODBuild, ESPMode::ThreadSafe>();
+	LODBuild->FullResolutionVertices = CurrentLOD == 0 ? &Section->ProcVertexBuffer : &FullResolutionVertices;
+	LODBuild->VerticesInHole = &VerticesInHole;
+	LODBuild->VertexAmount = VertexAmount;
+	LODBuild->LOD = LOD;
+	LODBuild->SkirtDepth = ParentLandscape->LODSkirtDepth;
+	FGenerateLODWorker::QueueWork(LODBuild, FRuntimeEditableLandscapeModule::GetRebuildThreadPool());
+	return true;
+}
+
+bool URuntimeLandscapeComponent::ApplyLODBuild()
+{
+	if (!LODBuild.IsValid())
+	{
+		return false;
+	}
+
+	const ERuntimeLandscapeLODBuildState State = LODBuild->State.load();
+	if (State == RLLS_Cancelled)
+	{
+		// i.e. the thread pool was shut down, the LOD is requested again if it is still needed
+		LODBuild.Reset();
+		return false;
+	}
+	if (State != RLLS_Done)
+	{
+		return false;
+	}
+
+	FProcMeshSection& Section = *GetProcMeshSection(0);
+	if (CurrentLOD == 0)
+	{
+		// the full resolution is only kept on the CPU while a lower LOD is shown, including the skirts of LOD 0
+		FullResolutionVertices = MoveTemp(Section.ProcVertexBuffer);
+		FullResolutionIndices = MoveTemp(Section.ProcIndexBuffer);
+	}
+	Section.ProcVertexBuffer = MoveTemp(LODBuild->Vertices);
+	Section.ProcIndexBuffer = MoveTemp(LODBuild->Indices);
+	CurrentLOD = LODBuild->LOD;
+	LODBuild.Reset();
+
+	// the bounds and the collision don't change, so only the render state of the new LOD is uploaded
+	MarkRenderStateDirty();
+	return true;
+}
+
+void URuntimeLandscapeComponent::CancelLODBuild()
+{
+	if (!LODBuild.IsValid())
+	{
+		return;
+	}
+
+	ERuntimeLandscapeLODBuildState ExpectedState = RLLS_Queued;
+	if (!LODBuild->State.compare_exchange_strong(ExpectedState, RLLS_Cancelled))
+	{
+		// the mesh of a single LOD is already generated, the data it reads has to stay valid until it is done
+		LODBuild->FinishedEvent->Wait();
+	}
+	LODBuild.Reset();
+}
+
+bool URuntimeLandscapeComponent::GetPhysicsTriMeshData(FTriMeshCollisionData* CollisionData, bool InUseAllTriData)
+{
+	// while LOD 0 is shown, the full resolution is at the start of the rendered section
+	const FProcMeshSection* Section = GetProcMeshSection(0);
+	const bool bIsInSection = FullResolutionVertices.IsEmpty();
+	if (NumFullResolutionIndices == 0 || (bIsInSection && !Section))
+	{
+		return false;
+	}
+
+	const TArray<FProcMeshVertex>& Vertices = bIsInSection ? Section->ProcVertexBuffer : FullResolutionVertices;
+	const TArray<uint32>& Indices = bIsInSection ? Section->ProcIndexBuffer : FullResolutionIndices;
+
+	// same layout as UProceduralMeshComponent, but always the full resolution instead of the rendered LOD
+	const bool bCopyUVs = UPhysicsSettings::Get()->bSupportUVFromHitResults;
+	if (bCopyUVs)
+	{
+		CollisionData->UVs.AddZeroed(1);
+	}
+
+	CollisionData->Vertices.Reserve(NumFullResolutionVertices);
+	for (int32 i = 0; i < NumFullResolutionVertices; i++)
+	{
+		CollisionData->Vertices.Add(FVector3f(Vertices[i].Position));
+		if (bCopyUVs)
+		{
+			CollisionData->UVs[0].Add(Vertices[i].UV0);
+		}
+	}
+
+	CollisionData->Indices.Reserve(NumFullResolutionIndices / 3);
+	for (int32 i = 0; i + 2 < NumFullResolutionIndices; i += 3)
+	{
+		FTriIndices& Triangle = CollisionData->Indices.AddDefaulted_GetRef();
+		Triangle.v0 = Indices[i];
+		Triangle.v1 = Indices[i + 1];
+		Triangle.v2 = Indices[i + 2];
+		CollisionData->MaterialIndices.Add(0);
+	}
+
+	CollisionData->bFlipNormals = true;
+	CollisionData->bDeformableMesh = true;
+	CollisionData->bFastCook = true;
+	return true;
+}
+
+bool URuntimeLandscapeComponent::ContainsPhysicsTriMeshData(bool InUseAllTriData) const
+{
+	return ParentLandscape && ParentLandscape->bUpdateCollision && !ParentLandscape->bUseHeightFieldCollision &&
+		NumFullResolutionIndices > 0;
+}
+
+void URuntimeLandscapeComponent::GatherGrass(FRuntimeLandscapeRebuildBuffer& RebuildBuffer,
+                                             FRuntimeLandscapeApplyState& ApplyState)
+{
+	TMap<const UStaticMesh*, int32> GrassIndices;
+	for (FLandscapeAdditionalData& AdditionalData : RebuildBuffer.AdditionalData)
+	{
+		for (auto& GrassData : AdditionalData.GrassData)
 		{
-			GrassMesh->DestroyComponent();
+			if (GrassData.Value.InstanceTransformsRelative.IsEmpty() == false)
+			{
+				const int32* GrassIndex = GrassIndices.Find(GrassData.Key);
+				if (GrassIndex)
+				{
+					ApplyState.GrassPerMesh[*GrassIndex].InstanceTransformsRelative.Append(
+						GrassData.Value.InstanceTransformsRelative);
+				}
+				else
+				{
+					GrassIndices.Add(GrassData.Key, ApplyState.GrassPerMesh.Add(MoveTemp(GrassData.Value)));
+				}
+			}
 		}
 	}
 
+	// clean up grass meshes that are not used anymore, the others are updated in place
+	TSet<const UStaticMesh*> UsedMeshes;
+	for (const auto& GrassIndex : GrassIndices)
+	{
+		UsedMeshes.Add(GrassIndex.Key);
+	}
+	ParentLandscape->GetGrassManager()->RemoveComponentGrass(this, &UsedMeshes);
+}
+
+void URuntimeLandscapeComponent::DestroyComponent(bool bPromoteChildren)
+{
+	if (ParentLandscape && ParentLandscape->GetGrassManager())
+	{
+		ParentLandscape->GetGrassManager()->RemoveComponentGrass(this);
+	}
+
+	if (CollisionComponent)
+	{
+		CollisionComponent->DestroyComponent();
+	}
+
 	Super::DestroyComponent(bPromoteChildren);
 }
+
+void URuntimeLandscapeComponent::BeginDestroy()
+{
+	// the rebuild threads must not read the mesh of a destroyed component
+	CancelLODBuild();
+	Super::BeginDestroy();
+}
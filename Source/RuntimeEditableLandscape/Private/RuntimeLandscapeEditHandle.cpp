@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RuntimeLandscapeEditHandle.h"
+
+#include "RuntimeLandscape.h"
+#include "RuntimeLandscapeComponent.h"
+
+void FRuntimeLandscapeEditHandle::AddComponent(const URuntimeLandscapeComponent* Component)
+{
+	if (ensure(Component))
+	{
+		FComponentTicket& Ticket = Tickets.AddDefaulted_GetRef();
+		Ticket.Component = Component;
+		Ticket.Generation = Component->GetRebuildGeneration();
+	}
+}
+
+void FRuntimeLandscapeEditHandle::AddPendingLandscape(const ARuntimeLandscape* Landscape)
+{
+	if (ensure(Landscape))
+	{
+		PendingLandscapes.AddUnique(Landscape);
+	}
+}
+
+void FRuntimeLandscapeEditHandle::Append(const FRuntimeLandscapeEditHandle& Other)
+{
+	Tickets.Append(Other.Tickets);
+	for (const TWeakObjectPtr<const ARuntimeLandscape>& Landscape : Other.PendingLandscapes)
+	{
+		PendingLandscapes.AddUnique(Landscape);
+	}
+}
+
+bool FRuntimeLandscapeEditHandle::IsComplete() const
+{
+	for (const FComponentTicket& Ticket : Tickets)
+	{
+		const URuntimeLandscapeComponent* Component = Ticket.Component.Get();
+		if (Component && !Component->IsGenerationApplied(Ticket.Generation))
+		{
+			return false;
+		}
+	}
+
+	for (const TWeakObjectPtr<const ARuntimeLandscape>& LandscapePtr : PendingLandscapes)
+	{
+		const ARuntimeLandscape* Landscape = LandscapePtr.Get();
+		if (Landscape && (!Landscape->IsInitialized() || Landscape->HasPendingRebuilds()))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
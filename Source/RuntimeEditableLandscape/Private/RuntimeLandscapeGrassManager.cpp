@@ -0,0 +1,270 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RuntimeLandscapeGrassManager.h"
+
+#include "LandscapeGrassType.h"
+#include "RuntimeLandscape.h"
+#include "RuntimeLandscapeComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+
+void URuntimeLandscapeGrassManager::SetComponentGrass(const URuntimeLandscapeComponent* Component,
+                                                      const FGrassVariety& Variety,
+                                                      const TArray<FTransform>& InstanceTransforms)
+{
+	const int32 ComponentIndex = Component->GetComponentIndex();
+	const FIntPoint* CurrentCell = ComponentCells.Find(ComponentIndex);
+	const FIntPoint CellCoordinates = CurrentCell ? *CurrentCell : GetCellCoordinates(Component);
+	FRuntimeLandscapeGrassCell& Cell = Cells.FindOrAdd(CellCoordinates);
+	FRuntimeLandscapeGrassCellMesh& CellMesh = FindOrAddCellMesh(Cell, Variety);
+	ComponentCells.Add(ComponentIndex, CellCoordinates);
+
+	// the instanced meshes are attached to the landscape, the grass is generated relative to the component
+	const FTransform ComponentToMesh = Component->GetComponentTransform().GetRelativeTransform(
+		CellMesh.InstancedMesh->GetComponentTransform());
+	TArray<FTransform> Transforms;
+	Transforms.Reserve(InstanceTransforms.Num());
+	for (const FTransform& InstanceTransform : InstanceTransforms)
+	{
+		Transforms.Add(InstanceTransform * ComponentToMesh);
+	}
+
+	// the spare instances are hidden at the component, so they don't grow the bounds of the cluster tree
+	const FTransform HiddenTransform(FQuat::Identity, ComponentToMesh.GetLocation(), FVector::ZeroVector);
+	const int32 NumInstances = Transforms.Num();
+	FRuntimeLandscapeGrassRange* Range = CellMesh.ComponentRanges.Find(ComponentIndex);
+	if (Range && NumInstances > Range->Capacity)
+	{
+		if (Range->Start + Range->Capacity == CellMesh.InstancedMesh->GetInstanceCount())
+		{
+			// the last range grows in place
+			const int32 NewCapacity = GetRangeCapacity(NumInstances);
+			AddHiddenInstances(CellMesh, NewCapacity - Range->Capacity, HiddenTransform);
+			Range->Capacity = NewCapacity;
+		}
+		else
+		{
+			// the range moves to the end of the mesh
+			FreeComponentInstances(CellMesh, ComponentIndex);
+			Range = nullptr;
+		}
+	}
+
+	if (!Range)
+	{
+		if (NumInstances == 0)
+		{
+			return;
+		}
+
+		Range = &CellMesh.ComponentRanges.Add(ComponentIndex, {CellMesh.InstancedMesh->GetInstanceCount(), 0,
+		                                                       GetRangeCapacity(NumInstances)});
+		AddHiddenInstances(CellMesh, Range->Capacity, HiddenTransform);
+	}
+
+	// instances that are not used anymore are hidden in the same batch
+	for (int32 i = NumInstances; i < Range->Num; i++)
+	{
+		Transforms.Add(HiddenTransform);
+	}
+
+	if (!Transforms.IsEmpty())
+	{
+		CellMesh.InstancedMesh->BatchUpdateInstancesTransforms(Range->Start, Transforms, false, true);
+	}
+	Range->Num = NumInstances;
+	CompactInstances(CellMesh);
+}
+
+SIZE_T URuntimeLandscapeGrassManager::RemoveComponentGrass(const URuntimeLandscapeComponent* Component,
+                                                           const TSet<const UStaticMesh*>* MeshesToKeep)
+{
+	const int32 ComponentIndex = Component->GetComponentIndex();
+	const FIntPoint* CellCoordinates = ComponentCells.Find(ComponentIndex);
+	FRuntimeLandscapeGrassCell* Cell = CellCoordinates ? Cells.Find(*CellCoordinates) : nullptr;
+	if (!Cell)
+	{
+		ComponentCells.Remove(ComponentIndex);
+		return 0;
+	}
+
+	SIZE_T RemovedSize = 0;
+	bool bHasRemainingGrass = false;
+	for (auto It = Cell->Meshes.CreateIterator(); It; ++It)
+	{
+		FRuntimeLandscapeGrassCellMesh& CellMesh = It.Value();
+		if (!CellMesh.ComponentRanges.Contains(ComponentIndex))
+		{
+			continue;
+		}
+
+		if (MeshesToKeep && MeshesToKeep->Contains(It.Key()))
+		{
+			bHasRemainingGrass = true;
+			continue;
+		}
+
+		RemovedSize += GetComponentGrassSize(CellMesh, ComponentIndex);
+		FreeComponentInstances(CellMesh, ComponentIndex);
+		if (CellMesh.ComponentRanges.IsEmpty())
+		{
+			if (CellMesh.InstancedMesh)
+			{
+				CellMesh.InstancedMesh->DestroyComponent();
+			}
+			It.RemoveCurrent();
+		}
+		else
+		{
+			CompactInstances(CellMesh);
+		}
+	}
+
+	if (Cell->Meshes.IsEmpty())
+	{
+		Cells.Remove(*CellCoordinates);
+	}
+
+	if (!bHasRemainingGrass)
+	{
+		ComponentCells.Remove(ComponentIndex);
+	}
+
+	return RemovedSize;
+}
+
+bool URuntimeLandscapeGrassManager::HasGrass(const URuntimeLandscapeComponent* Component) const
+{
+	return ComponentCells.Contains(Component->GetComponentIndex());
+}
+
+SIZE_T URuntimeLandscapeGrassManager::GetGrassSize() const
+{
+	SIZE_T Size = 0;
+	for (const auto& Cell : Cells)
+	{
+		for (const auto& CellMesh : Cell.Value.Meshes)
+		{
+			if (CellMesh.Value.InstancedMesh)
+			{
+				Size += CellMesh.Value.InstancedMesh->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+			}
+		}
+	}
+
+	return Size;
+}
+
+FIntPoint URuntimeLandscapeGrassManager::GetCellCoordinates(const URuntimeLandscapeComponent* Component) const
+{
+	const ARuntimeLandscape* Landscape = Component->GetParentLandscape();
+	const float ComponentSize = Landscape->GetComponentResolution().X * Landscape->GetQuadSideLength();
+	const FVector2D ComponentCenter = FVector2D(Component->GetRelativeLocation()) + ComponentSize / 2;
+	const FVector2D Cell = ComponentCenter / FMath::Max(Landscape->GrassCellSize, 1.0f);
+	return FIntPoint(FMath::FloorToInt32(Cell.X), FMath::FloorToInt32(Cell.Y));
+}
+
+FRuntimeLandscapeGrassCellMesh& URuntimeLandscapeGrassManager::FindOrAddCellMesh(FRuntimeLandscapeGrassCell& Cell,
+	const FGrassVariety& Variety)
+{
+	FRuntimeLandscapeGrassCellMesh& CellMesh = Cell.Meshes.FindOrAdd(Variety.GrassMesh);
+	if (CellMesh.InstancedMesh)
+	{
+		return CellMesh;
+	}
+
+	UHierarchicalInstancedStaticMeshComponent* InstancedMesh = NewObject<
+		UHierarchicalInstancedStaticMeshComponent>(GetOwner());
+	InstancedMesh->SetStaticMesh(Variety.GrassMesh);
+	InstancedMesh->AttachToComponent(GetOwner()->GetRootComponent(),
+	                                 FAttachmentTransformRules::SnapToTargetIncludingScale);
+	InstancedMesh->RegisterComponent();
+	InstancedMesh->SetCullDistances(Variety.GetStartCullDistance(), Variety.GetEndCullDistance());
+	InstancedMesh->SetCastShadow(Variety.bCastDynamicShadow);
+	InstancedMesh->SetCastContactShadow(Variety.bCastContactShadow);
+
+	CellMesh.InstancedMesh = InstancedMesh;
+	return CellMesh;
+}
+
+void URuntimeLandscapeGrassManager::AddHiddenInstances(FRuntimeLandscapeGrassCellMesh& CellMesh, int32 NumInstances,
+                                                       const FTransform& HiddenTransform)
+{
+	if (NumInstances > 0)
+	{
+		TArray<FTransform> Instances;
+		Instances.Init(HiddenTransform, NumInstances);
+		CellMesh.InstancedMesh->AddInstances(Instances, false);
+	}
+}
+
+void URuntimeLandscapeGrassManager::FreeComponentInstances(FRuntimeLandscapeGrassCellMesh& CellMesh,
+                                                           int32 ComponentIndex)
+{
+	FRuntimeLandscapeGrassRange Range;
+	if (!CellMesh.ComponentRanges.RemoveAndCopyValue(ComponentIndex, Range))
+	{
+		return;
+	}
+
+	UHierarchicalInstancedStaticMeshComponent* InstancedMesh = CellMesh.InstancedMesh;
+	if (!InstancedMesh)
+	{
+		return;
+	}
+
+	// the spare instances are hidden already
+	TArray<FTransform> Transforms;
+	Transforms.SetNum(Range.Num);
+	for (int32 i = 0; i < Range.Num; i++)
+	{
+		InstancedMesh->GetInstanceTransform(Range.Start + i, Transforms[i], false);
+		Transforms[i].SetScale3D(FVector::ZeroVector);
+	}
+
+	if (!Transforms.IsEmpty())
+	{
+		InstancedMesh->BatchUpdateInstancesTransforms(Range.Start, Transforms, false, true);
+	}
+	CellMesh.NumFreeInstances += Range.Capacity;
+}
+
+void URuntimeLandscapeGrassManager::CompactInstances(FRuntimeLandscapeGrassCellMesh& CellMesh)
+{
+	UHierarchicalInstancedStaticMeshComponent* InstancedMesh = CellMesh.InstancedMesh;
+	if (!InstancedMesh || CellMesh.NumFreeInstances * 2 <= InstancedMesh->GetInstanceCount())
+	{
+		return;
+	}
+
+	// the components keep their spare instances
+	TArray<FTransform> Instances;
+	Instances.Reserve(InstancedMesh->GetInstanceCount() - CellMesh.NumFreeInstances);
+	for (auto& Range : CellMesh.ComponentRanges)
+	{
+		const int32 Start = Instances.Num();
+		for (int32 i = Range.Value.Start; i < Range.Value.Start + Range.Value.Capacity; i++)
+		{
+			InstancedMesh->GetInstanceTransform(i, Instances.AddDefaulted_GetRef(), false);
+		}
+		Range.Value.Start = Start;
+	}
+
+	InstancedMesh->ClearInstances();
+	InstancedMesh->AddInstances(Instances, false);
+	CellMesh.NumFreeInstances = 0;
+}
+
+SIZE_T URuntimeLandscapeGrassManager::GetComponentGrassSize(const FRuntimeLandscapeGrassCellMesh& CellMesh,
+                                                            int32 ComponentIndex)
+{
+	const FRuntimeLandscapeGrassRange* Range = CellMesh.ComponentRanges.Find(ComponentIndex);
+	if (!Range || !CellMesh.InstancedMesh || CellMesh.InstancedMesh->GetInstanceCount() == 0)
+	{
+		return 0;
+	}
+
+	// the share of the component in the instance data of the mesh, including its spare instances
+	return CellMesh.InstancedMesh->GetResourceSizeBytes(EResourceSizeMode::Exclusive) * Range->Capacity /
+		CellMesh.InstancedMesh->GetInstanceCount();
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RuntimeLandscapeMemoryUsage.h"
+
+namespace RuntimeLandscapeMemoryUsage
+{
+	double ToMiB(SIZE_T Bytes)
+	{
+		return Bytes / (1024.0 * 1024.0);
+	}
+}
+
+FRuntimeLandscapeMemoryUsage& FRuntimeLandscapeMemoryUsage::operator+=(const FRuntimeLandscapeMemoryUsage& Other)
+{
+	BaseHeights += Other.BaseHeights;
+	Holes += Other.Holes;
+	MeshSections += Other.MeshSections;
+	Collision += Other.Collision;
+	Grass += Other.Grass;
+	LayerWeights += Other.LayerWeights;
+	RebuildBuffers += Other.RebuildBuffers;
+	return *this;
+}
+
+FString FRuntimeLandscapeMemoryUsage::ToString() const
+{
+	using namespace RuntimeLandscapeMemoryUsage;
+	return FString::Printf(
+		TEXT("%.2f MiB (base heights %.2f, holes %.2f, mesh sections %.2f, collision %.2f, grass %.2f, ")
+		TEXT("layer weights %.2f, rebuild buffers %.2f)"),
+		ToMiB(GetTotal()), ToMiB(BaseHeights), ToMiB(Holes), ToMiB(MeshSections), ToMiB(Collision), ToMiB(Grass),
+		ToMiB(LayerWeights), ToMiB(RebuildBuffers));
+}
@@ -4,57 +4,58 @@
 #include "Threads/GenerateAdditionalVertexDataWorker.h"
 
 #include "LandscapeGrassType.h"
-#include "RuntimeLandscapeComponent.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Threads/RuntimeLandscapeRebuildManager.h"
 
 FGenerateAdditionalVertexDataWorker::FGenerateAdditionalVertexDataWorker(
-	URuntimeLandscapeRebuildManager* RebuildManager)
+	const FRuntimeLandscapeRebuildJobPtr& InJob, int32 Y) : YCoordinate(Y), Job(InJob)
 {
-	this->RebuildManager = RebuildManager;
 }
 
-FGenerateAdditionalVertexDataWorker::~FGenerateAdditionalVertexDataWorker()
-{
-	checkNoEntry();
-}
-
-void FGenerateAdditionalVertexDataWorker::GenerateGrassDataForVertex(const int32 VertexIndex, int32 X)
+void FGenerateAdditionalVertexDataWorker::GenerateGrassDataForVertex(FRuntimeLandscapeRebuildJob& Job,
+                                                                     const int32 VertexIndex, int32 X, int32 Y)
 {
 	// Don't add grass at first row or column, since it overlaps with the last row or column of neighboring component
-	if (YCoordinate == 0 || X == 0)
+	if (Y == 0 || X == 0)
 	{
-		RebuildManager->DataBuffer.AdditionalData[VertexIndex].ClearData();
+		Job.Buffer.AdditionalData[VertexIndex].ClearData();
 		return;
 	}
 
-	FGrassTypeSettings SelectedGrass;
+	const FRuntimeLandscapeGrassRule* SelectedGrass = nullptr;
 	float HighestWeight = 0;
 
 	bool bIsLayerApplied = false;
-	for (const auto& LayerWeightData : RebuildManager->Landscape->GetGroundTypeLayerWeightsAtVertexCoordinates(
-		     RebuildManager->CurrentComponent->GetComponentIndex(), X, YCoordinate))
+	for (const FRuntimeLandscapeGroundTypeWeights& LayerSet : Job.GroundTypeWeights)
 	{
-		if (LayerWeightData.Value >= HighestWeight && LayerWeightData.Value > 0.2f)
+		const FColor& VertexWeights = LayerSet.VertexWeights[VertexIndex];
+		for (int32 Channel = 0; Channel < 4; ++Channel)
 		{
-			HighestWeight = LayerWeightData.Value;
-			SelectedGrass = LayerWeightData.Key->GrassTypeSettings;
-			bIsLayerApplied = true;
+			if (!LayerSet.HasGroundType[Channel])
+			{
+				continue;
+			}
+
+			const float Weight = FRuntimeLandscapeGroundTypeWeights::GetChannelWeight(VertexWeights, Channel);
+			if (Weight >= HighestWeight && Weight > 0.2f)
+			{
+				HighestWeight = Weight;
+				SelectedGrass = &LayerSet.Grass[Channel];
+				bIsLayerApplied = true;
+			}
 		}
 	}
 
 	// if no layer is applied, check if height based grass should be displayed
 	if (!bIsLayerApplied)
 	{
-		const float VertexHeight = (RebuildManager->DataBuffer.VerticesRelative[VertexIndex]
-			+ RebuildManager->CurrentComponent->GetComponentLocation()).Z;
+		const float VertexHeight = (Job.Buffer.VerticesRelative[VertexIndex] + Job.ComponentLocation).Z;
 
-		for (const FHeightBasedLandscapeData& HeightBasedData : RebuildManager->CurrentComponent->
-		     GetParentLandscape()->GetHeightBasedData())
+		for (const FRuntimeLandscapeHeightGrassRule& HeightBasedGrass : Job.HeightBasedGrass)
 		{
-			if (HeightBasedData.MinHeight < VertexHeight && HeightBasedData.MaxHeight > VertexHeight)
+			if (HeightBasedGrass.MinHeight < VertexHeight && HeightBasedGrass.MaxHeight > VertexHeight)
 			{
-				SelectedGrass = HeightBasedData.Grass;
+				SelectedGrass = &HeightBasedGrass.Grass;
 				HighestWeight = 1.0f;
 				bIsLayerApplied = true;
 			}
@@ -62,25 +63,27 @@ void FGenerateAdditionalVertexDataWorker::GenerateGrassDataForVertex(const int32
 	}
 
 	// clean data carried over from previous run
-	RebuildManager->DataBuffer.AdditionalData[VertexIndex].ClearData();
+	Job.Buffer.AdditionalData[VertexIndex].ClearData();
 
 	if (bIsLayerApplied)
 	{
-		GenerateGrassTransformsAtVertex(SelectedGrass, VertexIndex, HighestWeight);
+		GenerateGrassTransformsAtVertex(Job, *SelectedGrass, VertexIndex, HighestWeight);
 	}
 }
 
-void FGenerateAdditionalVertexDataWorker::GenerateGrassTransformsAtVertex(const FGrassTypeSettings& SelectedGrass,
+void FGenerateAdditionalVertexDataWorker::GenerateGrassTransformsAtVertex(FRuntimeLandscapeRebuildJob& Job,
+                                                                          const FRuntimeLandscapeGrassRule&
+                                                                          SelectedGrass,
                                                                           const int32 VertexIndex,
-                                                                          float Weight) const
+                                                                          float Weight)
 {
-	if (!IsValid(SelectedGrass.GrassType))
+	if (SelectedGrass.Varieties.IsEmpty())
 	{
 		return;
 	}
 
 
-	const FVector& Normal = RebuildManager->DataBuffer.Normals[VertexIndex];
+	const FVector& Normal = Job.Buffer.Normals[VertexIndex];
 
 	float Roll;
 	float Pitch;
@@ -94,15 +97,14 @@ void FGenerateAdditionalVertexDataWorker::GenerateGrassTransformsAtVertex(const
 	}
 
 	FRotator SurfaceAlignmentRotation = UKismetMathLibrary::MakeRotFromZ(Normal);
-	const FVector& VertexRelativeLocation = RebuildManager->DataBuffer.VerticesRelative[VertexIndex];
-	FLandscapeAdditionalData& AdditionalData = RebuildManager->DataBuffer.AdditionalData[VertexIndex];
+	const FVector& VertexRelativeLocation = Job.Buffer.VerticesRelative[VertexIndex];
+	FLandscapeAdditionalData& AdditionalData = Job.Buffer.AdditionalData[VertexIndex];
 
-	for (const FGrassVariety& Variety : SelectedGrass.GrassType->GrassVarieties)
+	for (const FGrassVariety& Variety : SelectedGrass.Varieties)
 	{
 		FLandscapeGrassVertexData& GrassData = AdditionalData.GrassData.FindOrAdd(Variety.GrassMesh);
 
-		float InstanceCount = RebuildManager->Landscape->GetAreaPerSquare() * Variety.GetDensity() * 0.000001f *
-			Weight;
+		float InstanceCount = Job.AreaPerSquare * Variety.GetDensity() * 0.000001f * Weight;
 		int32 RemainingInstanceCount = FMath::FloorToInt(InstanceCount);
 
 		// round up based on decimal remainder
@@ -118,7 +120,7 @@ void FGenerateAdditionalVertexDataWorker::GenerateGrassTransformsAtVertex(const
 		while (RemainingInstanceCount > 0)
 		{
 			FVector GrassLocationRelative;
-			GetRandomGrassLocation(VertexRelativeLocation, GrassLocationRelative);
+			GetRandomGrassLocation(Job, VertexRelativeLocation, GrassLocationRelative);
 
 			FRotator Rotation;
 			GetRandomGrassRotation(Variety, Rotation);
@@ -135,7 +137,7 @@ void FGenerateAdditionalVertexDataWorker::GenerateGrassTransformsAtVertex(const
 }
 
 void FGenerateAdditionalVertexDataWorker::GetRandomGrassRotation(const FGrassVariety& Variety,
-                                                                 FRotator& OutRotation) const
+                                                                 FRotator& OutRotation)
 {
 	if (Variety.RandomRotation)
 	{
@@ -144,17 +146,18 @@ void FGenerateAdditionalVertexDataWorker::GetRandomGrassRotation(const FGrassVar
 	}
 }
 
-void FGenerateAdditionalVertexDataWorker::GetRandomGrassLocation(const FVector& VertexRelativeLocation,
-                                                                 FVector& OutGrassLocation) const
+void FGenerateAdditionalVertexDataWorker::GetRandomGrassLocation(const FRuntimeLandscapeRebuildJob& Job,
+                                                                 const FVector& VertexRelativeLocation,
+                                                                 FVector& OutGrassLocation)
 {
 	float PosX = FMath::RandRange(-0.5f, 0.5f);
 	float PosY = FMath::RandRange(-0.5f, 0.5f);
 
-	float SideLength = RebuildManager->CurrentComponent->GetParentLandscape()->GetQuadSideLength();
+	float SideLength = Job.GenerationData.VertexDistance;
 	OutGrassLocation = VertexRelativeLocation + FVector(PosX * SideLength, PosY * SideLength, 0.0f);
 }
 
-void FGenerateAdditionalVertexDataWorker::GetRandomGrassScale(const FGrassVariety& Variety, FVector& OutScale) const
+void FGenerateAdditionalVertexDataWorker::GetRandomGrassScale(const FGrassVariety& Variety, FVector& OutScale)
 {
 	switch (Variety.Scaling)
 	{
@@ -177,15 +180,25 @@ void FGenerateAdditionalVertexDataWorker::GetRandomGrassScale(const FGrassVariet
 	}
 }
 
-void FGenerateAdditionalVertexDataWorker::DoThreadedWork()
+void FGenerateAdditionalVertexDataWorker::GenerateAdditionalDataForRow(FRuntimeLandscapeRebuildJob& Job, int32 Y)
 {
-	// skip first column of vertices (since it overlaps with last column of neighbor)
-	int32 VertexIndex = StartIndex;
-	for (int32 X = 0; X < RebuildManager->Landscape->GetComponentResolution().X + 1; ++X)
+	// the results of outdated rebuilds are never applied, don't waste time generating them
+	if (Job.IsStale())
+	{
+		return;
+	}
+
+	int32 VertexIndex = Y * Job.GetVertexAmountX();
+	for (int32 X = 0; X < Job.GetVertexAmountX(); ++X)
 	{
-		GenerateGrassDataForVertex(VertexIndex, X);
+		GenerateGrassDataForVertex(Job, VertexIndex, X, Y);
 		++VertexIndex;
 	}
+}
 
-	RebuildManager->NotifyRunnerFinished(this);
+void FGenerateAdditionalVertexDataWorker::DoThreadedWork()
+{
+	GenerateAdditionalDataForRow(*Job, YCoordinate);
+	Job->NotifyRunnerFinished();
+	delete this;
 }
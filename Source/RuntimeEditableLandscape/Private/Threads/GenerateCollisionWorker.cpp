@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Threads/GenerateCollisionWorker.h"
+
+#include "RuntimeLandscapeCollisionComponent.h"
+#include "Threads/RuntimeLandscapeRebuildManager.h"
+
+FGenerateCollisionWorker::FGenerateCollisionWorker(const FRuntimeLandscapeRebuildJobPtr& InJob) : Job(InJob)
+{
+}
+
+void FGenerateCollisionWorker::GenerateCollision(FRuntimeLandscapeRebuildJob& Job)
+{
+	// the results of outdated rebuilds are never applied, don't waste time generating them
+	if (Job.IsStale())
+	{
+		return;
+	}
+
+	const int32 Stride = Job.CollisionStride;
+	const FIntVector2 VertexAmount(Job.ComponentResolution.X + 1, Job.ComponentResolution.Y + 1);
+	const TSharedPtr<FRuntimeLandscapeCollisionData, ESPMode::ThreadSafe> Collision = MakeShared<
+		FRuntimeLandscapeCollisionData, ESPMode::ThreadSafe>();
+	Collision->NumSamples = FIntVector2(Job.ComponentResolution.X / Stride + 1, Job.ComponentResolution.Y / Stride + 1);
+	const float SampleDistance = Job.GenerationData.VertexDistance * Stride;
+	Collision->SampleScale = FVector(SampleDistance, SampleDistance, 1.0f) * Job.ComponentScale;
+
+	const FIntVector2& NumSamples = Collision->NumSamples;
+	Collision->Heights.SetNumUninitialized(NumSamples.X * NumSamples.Y);
+	for (int32 Y = 0; Y < NumSamples.Y; Y++)
+	{
+		for (int32 X = 0; X < NumSamples.X; X++)
+		{
+			const FVector& Vertex = Job.Buffer.VerticesRelative[Y * Stride * VertexAmount.X + X * Stride];
+			Collision->Heights[Y * NumSamples.X + X] = Vertex.Z;
+			Collision->LocalBox += Vertex;
+		}
+	}
+
+	Collision->MaterialIndices.Init(0, (NumSamples.X - 1) * (NumSamples.Y - 1));
+	for (const int32 VertexIndex : Job.VerticesInHole)
+	{
+		// every quad that touches the vertex is a hole, so is the collision quad that contains it
+		const int32 X = VertexIndex % VertexAmount.X;
+		const int32 Y = VertexIndex / VertexAmount.X;
+		for (int32 QuadY = FMath::Max(Y - 1, 0); QuadY <= FMath::Min(Y, VertexAmount.Y - 2); QuadY++)
+		{
+			for (int32 QuadX = FMath::Max(X - 1, 0); QuadX <= FMath::Min(X, VertexAmount.X - 2); QuadX++)
+			{
+				Collision->MaterialIndices[QuadY / Stride * (NumSamples.X - 1) + QuadX / Stride] =
+					FRuntimeLandscapeCollisionData::HoleMaterialIndex;
+			}
+		}
+	}
+
+	Collision->DirtyRect = FIntRect(0, 0, NumSamples.X - 1, NumSamples.Y - 1);
+	const FRuntimeLandscapeCollisionData* Previous = Job.PreviousCollision.Get();
+	const bool bCanEdit = Previous && Collision->IsEditableFrom(*Previous);
+	if (bCanEdit)
+	{
+		FIntRect DirtyRect(MAX_int32, MAX_int32, MIN_int32, MIN_int32);
+		for (int32 i = 0; i < Collision->Heights.Num(); i++)
+		{
+			if (Collision->Heights[i] != Previous->Heights[i])
+			{
+				const FIntPoint Sample(i % NumSamples.X, i / NumSamples.X);
+				DirtyRect.Min = DirtyRect.Min.ComponentMin(Sample);
+				DirtyRect.Max = DirtyRect.Max.ComponentMax(Sample);
+			}
+		}
+
+		if (DirtyRect.Min.X > DirtyRect.Max.X)
+		{
+			// the collision is up to date
+			return;
+		}
+
+		Collision->DirtyRect = DirtyRect;
+	}
+
+	// editing most of the heightfield in place is not cheaper than a new one, which keeps the physics lock short
+	const int32 NumDirtySamples = (Collision->DirtyRect.Width() + 1) * (Collision->DirtyRect.Height() + 1);
+	if (!bCanEdit || NumDirtySamples * 2 > Collision->Heights.Num())
+	{
+		Collision->HeightField = Collision->BuildHeightField();
+	}
+
+	Job.Collision = Collision;
+}
+
+void FGenerateCollisionWorker::DoThreadedWork()
+{
+	GenerateCollision(*Job);
+	Job->NotifyRunnerFinished();
+	delete this;
+}
@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Threads/GenerateLODWorker.h"
+
+FGenerateLODWorker::FGenerateLODWorker(const FRuntimeLandscapeLODBuildPtr& InBuild) : Build(InBuild)
+{
+}
+
+void FGenerateLODWorker::GenerateLODMesh(const TArray<FProcMeshVertex>& FullResolutionVertices,
+                                         const FIntVector2& VertexAmount, const TSet<int32>& VerticesInHole,
+                                         int32 LOD, float SkirtDepth, TArray<FProcMeshVertex>& OutVertices,
+                                         TArray<uint32>& OutIndices)
+{
+	const TArray<int32> SampledX = SampleCoordinates(VertexAmount.X, LOD);
+	const TArray<int32> SampledY = SampleCoordinates(VertexAmount.Y, LOD);
+	OutVertices.Reset(SampledX.Num() * SampledY.Num() + (SampledX.Num() + SampledY.Num()) * 4);
+	OutIndices.Reset();
+	for (int32 Y = 0; Y < SampledY.Num(); Y++)
+	{
+		for (int32 X = 0; X < SampledX.Num(); X++)
+		{
+			OutVertices.Add(FullResolutionVertices[SampledY[Y] * VertexAmount.X + SampledX[X]]);
+		}
+	}
+
+	auto IsQuadInHole = [&](int32 X, int32 Y)
+	{
+		for (int32 SourceY = SampledY[Y]; SourceY <= SampledY[Y + 1]; SourceY++)
+		{
+			for (int32 SourceX = SampledX[X]; SourceX <= SampledX[X + 1]; SourceX++)
+			{
+				if (VerticesInHole.Contains(SourceY * VertexAmount.X + SourceX))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	};
+
+	// same triangle layout as the full resolution, see URuntimeLandscapeRebuildManager::GenerateTriangleArray
+	for (int32 Y = 0; Y < SampledY.Num() - 1; Y++)
+	{
+		for (int32 X = 0; X < SampledX.Num() - 1; X++)
+		{
+			if (!VerticesInHole.IsEmpty() && IsQuadInHole(X, Y))
+			{
+				continue;
+			}
+
+			const uint32 T1 = Y * SampledX.Num() + X;
+			const uint32 T2 = T1 + SampledX.Num();
+			const uint32 T3 = T1 + 1;
+			OutIndices.Append({T1, T2, T3, T3, T2, T2 + 1});
+		}
+	}
+
+	AppendSkirts(FullResolutionVertices, VertexAmount, VerticesInHole, LOD, SkirtDepth, OutVertices, OutIndices);
+}
+
+void FGenerateLODWorker::AppendSkirts(const TArray<FProcMeshVertex>& FullResolutionVertices,
+                                      const FIntVector2& VertexAmount, const TSet<int32>& VerticesInHole, int32 LOD,
+                                      float SkirtDepth, TArray<FProcMeshVertex>& OutVertices,
+                                      TArray<uint32>& OutIndices)
+{
+	const TArray<int32> SampledX = SampleCoordinates(VertexAmount.X, LOD);
+	const TArray<int32> SampledY = SampleCoordinates(VertexAmount.Y, LOD);
+	auto GetSourceIndex = [&](int32 X, int32 Y) { return SampledY[Y] * VertexAmount.X + SampledX[X]; };
+
+	// walk around the border, so the skirts face outwards
+	TArray<int32> Border;
+	Border.Reserve((SampledX.Num() + SampledY.Num()) * 2);
+	for (int32 X = 0; X < SampledX.Num(); X++)
+	{
+		Border.Add(GetSourceIndex(X, 0));
+	}
+	for (int32 Y = 1; Y < SampledY.Num(); Y++)
+	{
+		Border.Add(GetSourceIndex(SampledX.Num() - 1, Y));
+	}
+	for (int32 X = SampledX.Num() - 2; X >= 0; X--)
+	{
+		Border.Add(GetSourceIndex(X, SampledY.Num() - 1));
+	}
+	for (int32 Y = SampledY.Num() - 2; Y > 0; Y--)
+	{
+		Border.Add(GetSourceIndex(0, Y));
+	}
+
+	const int32 SkirtStart = OutVertices.Num();
+	OutVertices.Reserve(SkirtStart + Border.Num() * 2);
+	OutIndices.Reserve(OutIndices.Num() + Border.Num() * 6);
+	for (const int32 SourceIndex : Border)
+	{
+		// copied first, the source might be the array that is added to
+		FProcMeshVertex Vertex = FullResolutionVertices[SourceIndex];
+		OutVertices.Add(Vertex);
+		Vertex.Position.Z -= SkirtDepth;
+		OutVertices.Add(Vertex);
+	}
+
+	for (int32 i = 0; i < Border.Num(); i++)
+	{
+		const int32 Next = (i + 1) % Border.Num();
+		if (VerticesInHole.Contains(Border[i]) || VerticesInHole.Contains(Border[Next]))
+		{
+			continue;
+		}
+
+		const uint32 Upper = SkirtStart + i * 2;
+		const uint32 NextUpper = SkirtStart + Next * 2;
+		OutIndices.Append({Upper, NextUpper, Upper + 1, NextUpper, NextUpper + 1, Upper + 1});
+	}
+}
+
+TArray<int32> FGenerateLODWorker::SampleCoordinates(int32 Amount, int32 LOD)
+{
+	const int32 Stride = 1 << LOD;
+	TArray<int32> Coordinates;
+	Coordinates.Reserve((Amount - 1) / Stride + 2);
+	for (int32 i = 0; i < Amount - 1; i += Stride)
+	{
+		Coordinates.Add(i);
+	}
+	Coordinates.Add(Amount - 1);
+	return Coordinates;
+}
+
+void FGenerateLODWorker::DoThreadedWork()
+{
+	// builds that were cancelled while queued never touch the data of the component
+	ERuntimeLandscapeLODBuildState ExpectedState = RLLS_Queued;
+	if (Build->State.compare_exchange_strong(ExpectedState, RLLS_Running))
+	{
+		GenerateLODMesh(*Build->FullResolutionVertices, Build->VertexAmount, *Build->VerticesInHole, Build->LOD,
+		                Build->SkirtDepth, Build->Vertices, Build->Indices);
+		Build->State = RLLS_Done;
+	}
+
+	Build->FinishedEvent->Trigger();
+	delete this;
+}
@@ -3,78 +3,235 @@
 
 #include "Threads/GenerateVerticesWorker.h"
 
-#include "KismetProceduralMeshLibrary.h"
 #include "RuntimeLandscape.h"
+#include "Threads/GenerateLODWorker.h"
 #include "Threads/RuntimeLandscapeRebuildManager.h"
 
-FGenerateVerticesWorker::FGenerateVerticesWorker(URuntimeLandscapeRebuildManager* RebuildManager)
+FGenerateVerticesWorker::FGenerateVerticesWorker(const FRuntimeLandscapeRebuildJobPtr& InJob,
+                                                 FQueuedThreadPool* InThreadPool) : Job(InJob), ThreadPool(InThreadPool)
 {
-	this->RebuildManager = RebuildManager;
 }
 
-FGenerateVerticesWorker::~FGenerateVerticesWorker()
+void FGenerateVerticesWorker::GenerateVertices(FRuntimeLandscapeRebuildJob& Job)
 {
-	checkNoEntry();
-}
+	ApplyLayers(Job);
 
-void FGenerateVerticesWorker::DoThreadedWork()
-{
-	const TArray<float>& HeightValues = RebuildManager->DataBuffer.HeightValues;
-	const ARuntimeLandscape* Landscape = RebuildManager->Landscape;
 	int32 VertexIndex = 0;
-	const FGenerationDataCache& DataCache = RebuildManager->GenerationDataCache;
-	FRuntimeLandscapeRebuildBuffer& DataBuffer = RebuildManager->DataBuffer;
+	const FGenerationDataCache& DataCache = Job.GenerationData;
+	FRuntimeLandscapeRebuildBuffer& DataBuffer = Job.Buffer;
 
 	// First row of vertices is handled differently
-	for (int32 X = 0; X <= Landscape->GetComponentResolution().X; X++)
+	for (int32 X = 0; X <= Job.ComponentResolution.X; X++)
 	{
-		const FVector Location(X * DataCache.VertexDistance, 0,
-		                       HeightValues[VertexIndex] - Landscape->GetParentHeight());
+		const FVector Location(X * DataCache.VertexDistance, 0, Job.GetHeight(VertexIndex) - Job.ParentHeight);
 		DataBuffer.VerticesRelative[VertexIndex] = Location;
-		const FVector2D UV0 = FVector2D(X * DataCache.UVIncrement, 0);
-		DataBuffer.UV0Coords[VertexIndex] = UV0;
-		DataBuffer.UV1Coords[VertexIndex] = UV0 * DataCache.UV1Scale + UV1Offset;
 		VertexIndex++;
 	}
 
-	for (int32 Y = 0; Y < Landscape->GetComponentResolution().Y; Y++)
+	for (int32 Y = 0; Y < Job.ComponentResolution.Y; Y++)
 	{
+		// drop the work early if the component was dirtied again in the meantime
+		if (Job.IsStale())
+		{
+			return;
+		}
+
 		const float Y1 = Y + 1;
-		FVector Location(0, Y1 * DataCache.VertexDistance, HeightValues[VertexIndex] - Landscape->GetParentHeight());
+		FVector Location(0, Y1 * DataCache.VertexDistance, Job.GetHeight(VertexIndex) - Job.ParentHeight);
 		DataBuffer.VerticesRelative[VertexIndex] = Location;
-
-		FVector2D UV0 = FVector2D(0, Y1 * DataCache.UVIncrement);
-		DataBuffer.UV0Coords[VertexIndex] = UV0;
-		DataBuffer.UV1Coords[VertexIndex] = UV0 * DataCache.UV1Scale + UV1Offset;
 		VertexIndex++;
 
 		// generate triangle strip in X direction
-		for (int32 X = 0; X < Landscape->GetComponentResolution().X; X++)
+		for (int32 X = 0; X < Job.ComponentResolution.X; X++)
 		{
 			Location = FVector((X + 1) * DataCache.VertexDistance, Y1 * DataCache.VertexDistance,
-			                   HeightValues[VertexIndex] - Landscape->GetParentHeight());
+			                   Job.GetHeight(VertexIndex) - Job.ParentHeight);
 			DataBuffer.VerticesRelative[VertexIndex] = Location;
+			VertexIndex++;
+		}
+	}
 
-			UV0 = FVector2D((X + 1) * DataCache.UVIncrement,
-			                Y1 * DataCache.UVIncrement);
-			DataBuffer.UV0Coords[VertexIndex] = UV0;
-			DataBuffer.UV1Coords[VertexIndex] = UV0 * DataCache.UV1Scale + UV1Offset;
+	// the UVs follow the grid as well, so no triangles are needed for the tangents
+	CalculateGridTangents(Job);
 
-			VertexIndex++;
+	if (Job.AdaptiveTolerance > 0.0f)
+	{
+		URuntimeLandscapeRebuildManager::GenerateAdaptiveTriangleArray(Job, DataBuffer.AdaptiveTriangles);
+	}
+	else
+	{
+		DataBuffer.AdaptiveTriangles.Reset();
+	}
+
+	if (!Job.IsStale())
+	{
+		FillSection(Job);
+	}
+}
+
+void FGenerateVerticesWorker::ApplyLayers(FRuntimeLandscapeRebuildJob& Job)
+{
+	TArray<float>& HeightValues = Job.Buffer.HeightValues;
+	Job.VerticesInHole.Reset();
+	if (Job.Layers.IsEmpty())
+	{
+		// the vertex kernel reads the shared base heights directly
+		HeightValues.Reset();
+		return;
+	}
+
+	Job.BaseHeights->Dequantize(HeightValues);
+	const int32 VertexAmountX = Job.GetVertexAmountX();
+	const int32 VertexAmountY = Job.ComponentResolution.Y + 1;
+	const float VertexDistance = Job.GenerationData.VertexDistance;
+	const FVector2D ComponentOrigin(Job.ComponentLocation);
+	for (const FLandscapeLayerSnapshot& Layer : Job.Layers)
+	{
+		if (Layer.Effects.IsEmpty())
+		{
+			continue;
+		}
+
+		// only the vertices inside the bounding box can be affected
+		const FLandscapeLayerFootprint& Footprint = Layer.Footprint;
+		const FVector2D MinVertex = (Footprint.BoundingBox.Min - ComponentOrigin) / VertexDistance;
+		const FVector2D MaxVertex = (Footprint.BoundingBox.Max - ComponentOrigin) / VertexDistance;
+		const int32 MinX = FMath::Max(FMath::FloorToInt32(MinVertex.X), 0);
+		const int32 MinY = FMath::Max(FMath::FloorToInt32(MinVertex.Y), 0);
+		const int32 MaxX = FMath::Min(FMath::CeilToInt32(MaxVertex.X), VertexAmountX - 1);
+		const int32 MaxY = FMath::Min(FMath::CeilToInt32(MaxVertex.Y), VertexAmountY - 1);
+		for (int32 Y = MinY; Y <= MaxY; Y++)
+		{
+			for (int32 X = MinX; X <= MaxX; X++)
+			{
+				const FVector2D VertexLocation = ComponentOrigin + FVector2D(X, Y) * VertexDistance;
+				float SmoothingFactor;
+				if (!Footprint.BoundingBox.IsInside(VertexLocation)
+					|| !Footprint.TryCalculateSmoothingFactor(SmoothingFactor, VertexLocation))
+				{
+					continue;
+				}
 
-			//
-			// const TSet<int32>& VerticesInHole = RebuildManager->CurrentComponent->VerticesInHole;
-			// if (VerticesInHole.Contains(T1) || VerticesInHole.Contains(T2) || VerticesInHole.Contains(T3) ||
-			// 	VerticesInHole.Contains(T2 + 1))
-			// {
-			// 	continue;
-			// }
+				const int32 VertexIndex = Y * VertexAmountX + X;
+				float& Height = HeightValues[VertexIndex];
+				for (const FLandscapeLayerVertexEffect& Effect : Layer.Effects)
+				{
+					switch (Effect.Type)
+					{
+					case ELandscapeLayerVertexEffect::Height:
+						Height = FMath::Lerp(Effect.Value, Height, SmoothingFactor);
+						break;
+					case ELandscapeLayerVertexEffect::Hole:
+						if (SmoothingFactor < Effect.Value)
+						{
+							Job.VerticesInHole.Add(VertexIndex);
+						}
+						break;
+					default:
+						checkNoEntry();
+					}
+				}
+			}
 		}
 	}
+}
+
+void FGenerateVerticesWorker::FillSection(FRuntimeLandscapeRebuildJob& Job)
+{
+	FRuntimeLandscapeRebuildBuffer& DataBuffer = Job.Buffer;
+	DataBuffer.SectionVertices.SetNumUninitialized(DataBuffer.VerticesRelative.Num());
+	DataBuffer.SectionLocalBox.Init();
+	const FGenerationDataCache& DataCache = Job.GenerationData;
+	const int32 VertexAmountX = Job.GetVertexAmountX();
+	for (int32 i = 0; i < DataBuffer.VerticesRelative.Num(); ++i)
+	{
+		FProcMeshVertex& Vertex = DataBuffer.SectionVertices[i];
+		Vertex.Position = DataBuffer.VerticesRelative[i];
+		Vertex.Normal = DataBuffer.Normals[i];
+		Vertex.Tangent = DataBuffer.Tangents[i];
+		Vertex.Color = FColor::White;
+		// the UVs only depend on the grid position, so they are not stored in the rebuild buffer
+		const FVector2D UV0 = FVector2D(i % VertexAmountX, i / VertexAmountX) * DataCache.UVIncrement;
+		Vertex.UV0 = UV0;
+		Vertex.UV1 = UV0 * DataCache.UV1Scale + DataBuffer.UV1Offset;
+		Vertex.UV2 = UV0;
+		Vertex.UV3 = UV0;
+		DataBuffer.SectionLocalBox += Vertex.Position;
+	}
+
+	// the adaptive triangulation already skips the holes, only components with holes need their own triangles
+	const bool bIsAdaptive = !DataBuffer.AdaptiveTriangles.IsEmpty();
+	FRuntimeLandscapeIndexArray HoleTriangles;
+	if (!bIsAdaptive && !Job.VerticesInHole.IsEmpty())
+	{
+		HoleTriangles = URuntimeLandscapeRebuildManager::GenerateTriangleArray(
+			Job.ComponentResolution, &Job.VerticesInHole);
+	}
+
+	const FRuntimeLandscapeIndexArray& Triangles = bIsAdaptive
+		                                               ? DataBuffer.AdaptiveTriangles
+		                                               : Job.VerticesInHole.IsEmpty()
+		                                               ? *Job.SharedTriangles
+		                                               : HoleTriangles;
+	// the procedural mesh only supports 32 bit indices, they are widened once while filling the section
+	DataBuffer.SectionIndices.SetNumUninitialized(Triangles.Num());
+	for (int32 i = 0; i < Triangles.Num(); ++i)
+	{
+		DataBuffer.SectionIndices[i] = Triangles[i];
+	}
+	DataBuffer.NumFullResolutionIndices = Triangles.Num();
+
+	// LOD 0 renders the full resolution with the skirts behind it, lower LODs get their own mesh
+	const FIntVector2 VertexAmount(VertexAmountX, Job.ComponentResolution.Y + 1);
+	FGenerateLODWorker::AppendSkirts(DataBuffer.SectionVertices, VertexAmount, Job.VerticesInHole, 0, Job.SkirtDepth,
+	                                 DataBuffer.SectionVertices, DataBuffer.SectionIndices);
+	if (Job.LOD > 0)
+	{
+		FGenerateLODWorker::GenerateLODMesh(DataBuffer.SectionVertices, VertexAmount, Job.VerticesInHole, Job.LOD,
+		                                    Job.SkirtDepth, DataBuffer.LODVertices, DataBuffer.LODIndices);
+	}
+}
+
+void FGenerateVerticesWorker::CalculateGridTangents(FRuntimeLandscapeRebuildJob& Job)
+{
+	FRuntimeLandscapeRebuildBuffer& DataBuffer = Job.Buffer;
+	const TArray<FVector>& Vertices = DataBuffer.VerticesRelative;
+	const int32 VertexAmountX = Job.GetVertexAmountX();
+	const int32 VertexAmountY = Job.ComponentResolution.Y + 1;
+	DataBuffer.Normals.SetNumUninitialized(Vertices.Num());
+	DataBuffer.Tangents.SetNumUninitialized(Vertices.Num());
+
+	// central differences of the heights, one sided at the borders of the component
+	for (int32 Y = 0; Y < VertexAmountY; Y++)
+	{
+		const int32 PreviousY = FMath::Max(Y - 1, 0);
+		const int32 NextY = FMath::Min(Y + 1, VertexAmountY - 1);
+		for (int32 X = 0; X < VertexAmountX; X++)
+		{
+			const int32 PreviousX = FMath::Max(X - 1, 0);
+			const int32 NextX = FMath::Min(X + 1, VertexAmountX - 1);
+			const FVector SlopeX = Vertices[Y * VertexAmountX + NextX] - Vertices[Y * VertexAmountX + PreviousX];
+			const FVector SlopeY = Vertices[NextY * VertexAmountX + X] - Vertices[PreviousY * VertexAmountX + X];
+
+			// the UVs follow X and Y, so the tangent follows the slope in X direction
+			const int32 VertexIndex = Y * VertexAmountX + X;
+			DataBuffer.Normals[VertexIndex] = FVector::CrossProduct(SlopeX, SlopeY).GetSafeNormal(
+				UE_SMALL_NUMBER, FVector::UpVector);
+			DataBuffer.Tangents[VertexIndex] = FProcMeshTangent(SlopeX.GetSafeNormal(UE_SMALL_NUMBER,
+				FVector::ForwardVector), false);
+		}
+	}
+}
 
-	UKismetProceduralMeshLibrary::CalculateTangentsForMesh(DataBuffer.VerticesRelative, DataBuffer.Triangles,
-	                                                       DataBuffer.UV0Coords, DataBuffer.Normals,
-	                                                       DataBuffer.Tangents);
+void FGenerateVerticesWorker::DoThreadedWork()
+{
+	GenerateVertices(*Job);
+	if (Job->BatchProgress.IsValid() && !Job->IsStale())
+	{
+		// batch rebuilds don't wait for the game thread between the stages
+		URuntimeLandscapeRebuildManager::QueueAdditionalDataStage(Job, ThreadPool);
+	}
 
-	RebuildManager->NotifyRunnerFinished(this);
+	Job->NotifyRunnerFinished();
+	delete this;
 }
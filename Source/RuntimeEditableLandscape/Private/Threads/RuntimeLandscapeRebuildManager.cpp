@@ -4,28 +4,152 @@
 #include "Threads/RuntimeLandscapeRebuildManager.h"
 
 #include "RuntimeEditableLandscape.h"
+#include "RuntimeLandscapeCollisionComponent.h"
 #include "RuntimeLandscapeComponent.h"
+#include "Misc/Compression.h"
 #include "Threads/GenerateAdditionalVertexDataWorker.h"
-#include "Threads/GenerateVerticesWorker.h"
+#include "Threads/GenerateCollisionWorker.h"
+#include "Threads/GenerateLODWorker.h"
+#include "Threads/RuntimeLandscapeRebuildSubsystem.h"
 
-URuntimeLandscapeRebuildManager::URuntimeLandscapeRebuildManager() : Super()
+FRuntimeLandscapeGrassRule::FRuntimeLandscapeGrassRule(const FGrassTypeSettings& Settings)
 {
-	bTickInEditor = true;
-	PrimaryComponentTick.bCanEverTick = true;
-	PrimaryComponentTick.bStartWithTickEnabled = false;
-	PrimaryComponentTick.TickInterval = 0.1f;
+	if (IsValid(Settings.GrassType))
+	{
+		Varieties = Settings.GrassType->GrassVarieties;
+	}
+
+	MaxSlopeAngle = Settings.MaxSlopeAngle;
 }
 
-void URuntimeLandscapeRebuildManager::QueueRebuild(URuntimeLandscapeComponent* ComponentToRebuild)
+void FRuntimeLandscapeQuantizedHeights::Quantize(const TArray<float>& HeightValues, const FFloatInterval& Range,
+                                                 float AdditionalOffset)
 {
-	if (CurrentComponent)
+	const float MinHeight = Range.IsValid() ? Range.Min : 0.0f;
+	const float MaxHeight = Range.IsValid() ? Range.Max : 0.0f;
+
+	Offset = MinHeight + AdditionalOffset;
+	Scale = (MaxHeight - MinHeight) / MAX_uint16;
+
+	Samples.SetNumUninitialized(HeightValues.Num());
+	for (int32 i = 0; i < HeightValues.Num(); i++)
 	{
-		RebuildQueue.AddUnique(ComponentToRebuild);
+		Samples[i] = Scale > 0.0f
+			             ? FMath::Clamp(FMath::RoundToInt32((HeightValues[i] - MinHeight) / Scale), 0, MAX_uint16)
+			             : 0;
 	}
-	else
+}
+
+void FRuntimeLandscapeQuantizedHeights::Dequantize(TArray<float>& OutHeightValues) const
+{
+	OutHeightValues.SetNumUninitialized(Samples.Num());
+	for (int32 i = 0; i < Samples.Num(); i++)
+	{
+		OutHeightValues[i] = Get(i);
+	}
+}
+
+bool FRuntimeLandscapeQuantizedHeights::Compress(FRuntimeLandscapeCompressedHeights& OutCompressed) const
+{
+	// neighbouring samples are similar, so the zigzag encoded deltas mostly fit into the low byte
+	// store the low and high bytes separately, the high bytes are almost all zero and compress very well
+	const int32 NumSamples = Samples.Num();
+	TArray<uint8> Deltas;
+	Deltas.SetNumUninitialized(NumSamples * sizeof(uint16));
+	uint16 Previous = 0;
+	for (int32 i = 0; i < NumSamples; i++)
+	{
+		const int16 Delta = static_cast<int16>(Samples[i] - Previous);
+		const uint16 Encoded = static_cast<uint16>((Delta << 1) ^ (Delta >> 15));
+		Deltas[i] = Encoded & 0xFF;
+		Deltas[NumSamples + i] = Encoded >> 8;
+		Previous = Samples[i];
+	}
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Oodle, Deltas.Num());
+	OutCompressed.Data.SetNumUninitialized(CompressedSize);
+	if (!FCompression::CompressMemory(NAME_Oodle, OutCompressed.Data.GetData(), CompressedSize, Deltas.GetData(),
+	                                  Deltas.Num()))
+	{
+		OutCompressed.Reset();
+		return false;
+	}
+
+	OutCompressed.Data.SetNum(CompressedSize);
+	OutCompressed.Data.Shrink();
+	OutCompressed.Offset = Offset;
+	OutCompressed.Scale = Scale;
+	OutCompressed.NumSamples = NumSamples;
+	return true;
+}
+
+bool FRuntimeLandscapeQuantizedHeights::Decompress(const FRuntimeLandscapeCompressedHeights& Compressed)
+{
+	const int32 NumSamples = Compressed.NumSamples;
+	TArray<uint8> Deltas;
+	Deltas.SetNumUninitialized(NumSamples * sizeof(uint16));
+	if (!FCompression::UncompressMemory(NAME_Oodle, Deltas.GetData(), Deltas.Num(), Compressed.Data.GetData(),
+	                                   Compressed.Data.Num()))
+	{
+		return false;
+	}
+
+	Samples.SetNumUninitialized(NumSamples);
+	uint16 Previous = 0;
+	for (int32 i = 0; i < NumSamples; i++)
+	{
+		const uint16 Encoded = Deltas[i] | Deltas[NumSamples + i] << 8;
+		const int16 Delta = static_cast<int16>((Encoded >> 1) ^ -(Encoded & 1));
+		Samples[i] = static_cast<uint16>(Previous + Delta);
+		Previous = Samples[i];
+	}
+
+	Offset = Compressed.Offset;
+	Scale = Compressed.Scale;
+	return true;
+}
+
+SIZE_T FRuntimeLandscapeRebuildBuffer::GetAllocatedSize() const
+{
+	SIZE_T Size = HeightValues.GetAllocatedSize() + VerticesRelative.GetAllocatedSize()
+		+ AdaptiveTriangles.GetAllocatedSize() + Normals.GetAllocatedSize() + Tangents.GetAllocatedSize() + SectionVertices.GetAllocatedSize()
+		+ SectionIndices.GetAllocatedSize() + LODVertices.GetAllocatedSize() + LODIndices.GetAllocatedSize()
+		+ AdditionalData.GetAllocatedSize();
+	for (const FLandscapeAdditionalData& VertexData : AdditionalData)
+	{
+		Size += VertexData.GrassData.GetAllocatedSize();
+		for (const auto& GrassData : VertexData.GrassData)
+		{
+			Size += GrassData.Value.InstanceTransformsRelative.GetAllocatedSize();
+		}
+	}
+
+	return Size;
+}
+
+SIZE_T URuntimeLandscapeRebuildManager::GetSpareBufferSize() const
+{
+	SIZE_T Size = SpareBuffers.GetAllocatedSize();
+	if (SharedTriangles.IsValid())
+	{
+		Size += SharedTriangles->GetAllocatedSize();
+	}
+
+	for (const FRuntimeLandscapeRebuildBuffer& Buffer : SpareBuffers)
+	{
+		Size += Buffer.GetAllocatedSize();
+	}
+
+	return Size;
+}
+
+void URuntimeLandscapeRebuildManager::QueueRebuild(URuntimeLandscapeComponent* ComponentToRebuild)
+{
+	URuntimeLandscapeRebuildSubsystem* RebuildSubsystem = UWorld::GetSubsystem<URuntimeLandscapeRebuildSubsystem>(
+		GetWorld());
+	if (ensure(RebuildSubsystem))
 	{
-		CurrentComponent = ComponentToRebuild;
-		StartRebuild();
+		RebuildSubsystem->QueueRebuild(ComponentToRebuild);
 	}
 }
 
@@ -34,63 +158,53 @@ void URuntimeLandscapeRebuildManager::InitializeGenerationCache()
 	GenerationDataCache.UV1Scale = FVector2D::One() / Landscape->GetComponentAmount();
 	GenerationDataCache.VertexDistance = Landscape->GetQuadSideLength();
 	GenerationDataCache.UVIncrement = 1 / Landscape->GetComponentResolution().X;
-}
 
-void URuntimeLandscapeRebuildManager::InitializeRunners()
-{
-	VertexRunner = new FGenerateVerticesWorker(this);
-	for (int32 i = 0; i < Landscape->GetComponentResolution().Y + 1; ++i)
+	const FIntVector2 ComponentResolution(FMath::RoundToInt(Landscape->GetComponentResolution().X),
+	                                      FMath::RoundToInt(Landscape->GetComponentResolution().Y));
+	if (!SharedTriangles.IsValid() || SharedTriangles->Num() != ComponentResolution.X * ComponentResolution.Y * 6)
 	{
-		FGenerateAdditionalVertexDataWorker* AdditionalDataRunner = new FGenerateAdditionalVertexDataWorker(this);
-		AdditionalDataRunners.Add(AdditionalDataRunner);
+		SharedTriangles = MakeShared<const FRuntimeLandscapeIndexArray, ESPMode::ThreadSafe>(
+			GenerateTriangleArray(ComponentResolution, nullptr));
 	}
-
-	ThreadPool = FQueuedThreadPool::Allocate();
-	int32 NumThreadsInThreadPool = FPlatformMisc::NumberOfWorkerThreadsToSpawn();
-	verify(
-		ThreadPool->Create(NumThreadsInThreadPool, 32 * 1024, TPri_Normal, TEXT("Runtime Landscape rebuild thread")));
 }
 
-void URuntimeLandscapeRebuildManager::InitializeBuffer()
+void URuntimeLandscapeRebuildManager::InitializeBuffer(FRuntimeLandscapeRebuildBuffer& OutBuffer) const
 {
 	int32 VertexAmount = Landscape->GetTotalVertexAmountPerComponent();
 
-	DataBuffer = FRuntimeLandscapeRebuildBuffer();
-	DataBuffer.HeightValues.SetNumUninitialized(VertexAmount);
-	DataBuffer.VerticesRelative.SetNumUninitialized(VertexAmount);
-	DataBuffer.UV0Coords.SetNumUninitialized(VertexAmount);
-	DataBuffer.UV1Coords.SetNumUninitialized(VertexAmount);
+	OutBuffer = FRuntimeLandscapeRebuildBuffer();
+	OutBuffer.VerticesRelative.SetNumUninitialized(VertexAmount);
 
 	// initialize the grass data with empty structs
-	DataBuffer.AdditionalData.Empty(VertexAmount);
+	OutBuffer.AdditionalData.Empty(VertexAmount);
 	for (int32 i = 0; i < VertexAmount; ++i)
 	{
-		DataBuffer.AdditionalData.Add(FLandscapeAdditionalData());
+		OutBuffer.AdditionalData.Add(FLandscapeAdditionalData());
 	}
-
-	DataBuffer.Triangles = GenerateTriangleArray(nullptr);
 }
 
-TArray<int32> URuntimeLandscapeRebuildManager::GenerateTriangleArray(const TSet<int32>* HoleIndices) const
+FRuntimeLandscapeIndexArray URuntimeLandscapeRebuildManager::GenerateTriangleArray(
+	const FIntVector2& ComponentResolution, const TSet<int32>* HoleIndices)
 {
-	int32 EntryCount = Landscape->GetComponentResolution().X * Landscape->GetComponentResolution().Y * 6;
+	check((ComponentResolution.X + 1) * (ComponentResolution.Y + 1) <= MaxVerticesPerComponent);
+	int32 EntryCount = ComponentResolution.X * ComponentResolution.Y * 6;
 
 	if (HoleIndices)
 	{
 		EntryCount -= HoleIndices->Num() * 6;
 	}
 
-	TArray<int32> Result;
+	FRuntimeLandscapeIndexArray Result;
 	Result.Reserve(EntryCount);
 
 	// initialize triangle array, since the generation algorithm is always the same, this will always be the same for each component
-	for (int32 Y = 0; Y < Landscape->GetComponentResolution().Y; ++Y)
+	for (int32 Y = 0; Y < ComponentResolution.Y; ++Y)
 	{
-		for (int32 X = 0; X < Landscape->GetComponentResolution().X; ++X)
+		for (int32 X = 0; X < ComponentResolution.X; ++X)
 		{
-			const int32 T1 = Y * (Landscape->GetComponentResolution().X + 1) + X;
-			const int32 T2 = T1 + Landscape->GetComponentResolution().X + 1;
-			const int32 T3 = T1 + 1;
+			const uint16 T1 = Y * (ComponentResolution.X + 1) + X;
+			const uint16 T2 = T1 + ComponentResolution.X + 1;
+			const uint16 T3 = T1 + 1;
 
 			if (HoleIndices && (HoleIndices->Contains(T1) || HoleIndices->Contains(T2) || HoleIndices->Contains(T3)
 				|| HoleIndices->Contains(T2 + 1)))
@@ -106,76 +220,254 @@ TArray<int32> URuntimeLandscapeRebuildManager::GenerateTriangleArray(const TSet<
 			// add lower-right triangle
 			Result.Add(T3);
 			Result.Add(T2);
-			Result.Add(T2 + 1);
+			Result.Add(static_cast<uint16>(T2 + 1));
 		}
 	}
 
 	return Result;
 }
 
-void URuntimeLandscapeRebuildManager::StartRebuild()
+FRuntimeLandscapeRebuildJobPtr URuntimeLandscapeRebuildManager::CreateRebuildJob(
+	URuntimeLandscapeComponent* Component)
 {
-	Initialize();
-
-	UE_LOG(RuntimeEditableLandscape, Display, TEXT("Rebuilding Landscape component %s %i..."), *GetOwner()->GetName(),
-	       CurrentComponent->Index);
+	if (!Component->IsStreamedIn())
+	{
+		// streamed out while it was queued, it is rebuilt once it is streamed in again
+		return nullptr;
+	}
 
-	FIntVector2 SectionCoordinates;
-	Landscape->GetComponentCoordinates(CurrentComponent->Index, SectionCoordinates);
-	DataBuffer.UV1Offset = GenerationDataCache.UV1Scale * FVector2D(SectionCoordinates.X, SectionCoordinates.Y);
+	// the landscape dimensions might have changed in the editor, so this is refreshed for every job
+	Initialize();
 
 	// ensure the section data is valid
-	if (!ensure(CurrentComponent->InitialHeightValues.Num() == Landscape->GetTotalVertexAmountPerComponent()))
+	const FRuntimeLandscapeQuantizedHeightsPtr& BaseHeights = Component->GetBaseHeights();
+	if (!ensure(BaseHeights.IsValid() && BaseHeights->Num() == Landscape->GetTotalVertexAmountPerComponent()))
 	{
 		UE_LOG(RuntimeEditableLandscape, Warning,
 		       TEXT("Component %i could not generate valid data and will not be generated!"),
-		       CurrentComponent->Index);
-		return;
+		       Component->Index);
+		return nullptr;
+	}
+
+	FRuntimeLandscapeRebuildJobPtr Job = MakeShared<FRuntimeLandscapeRebuildJob, ESPMode::ThreadSafe>();
+	Job->ComponentIndex = Component->Index;
+	Job->GenerationCounter = Component->RebuildGeneration;
+	Job->Generation = Job->GenerationCounter->Get();
+	Job->ComponentResolution = FIntVector2(FMath::RoundToInt(Landscape->GetComponentResolution().X),
+	                                       FMath::RoundToInt(Landscape->GetComponentResolution().Y));
+	Job->ComponentLocation = Component->GetComponentLocation();
+	Job->ParentHeight = Landscape->GetParentHeight();
+	Job->AreaPerSquare = Landscape->GetAreaPerSquare();
+	Job->GenerationData = GenerationDataCache;
+	Job->SharedTriangles = SharedTriangles;
+	// a LOD that is still generated is shown once it is swapped in, so the rebuild generates that one instead
+	Job->LOD = Component->LODBuild.IsValid() ? Component->LODBuild->LOD : Component->CurrentLOD;
+	Job->SkirtDepth = Landscape->LODSkirtDepth;
+	Job->AdaptiveTolerance = Landscape->AdaptiveTriangulationTolerance;
+	Job->bBuildCollision = Landscape->bUpdateCollision && Landscape->bUseHeightFieldCollision;
+	if (Job->bBuildCollision)
+	{
+		Job->CollisionStride = Landscape->GetCollisionStride();
+		Job->ComponentScale = Component->GetComponentScale();
+		if (Component->CollisionComponent)
+		{
+			Job->PreviousCollision = Component->CollisionComponent->GetCollisionData();
+		}
+	}
+
+	// reuse the buffer of a previous job if possible
+	if (!SpareBuffers.IsEmpty()
+		&& SpareBuffers.Last().VerticesRelative.Num() == Landscape->GetTotalVertexAmountPerComponent())
+	{
+		Job->Buffer = SpareBuffers.Pop(false);
+	}
+	else
+	{
+		InitializeBuffer(Job->Buffer);
 	}
 
-	DataBuffer.RebuildState = ERuntimeLandscapeRebuildState::RLRS_BuildVertices;
-	DataBuffer.HeightValues = CurrentComponent->InitialHeightValues;
+	FIntVector2 SectionCoordinates;
+	Landscape->GetComponentCoordinates(Component->Index, SectionCoordinates);
+	Job->Buffer.UV1Offset = GenerationDataCache.UV1Scale * FVector2D(SectionCoordinates.X, SectionCoordinates.Y);
+
+	Job->BaseHeights = BaseHeights;
+	// only the parameters of the layers are captured, the vertex worker applies them to the heights
+	for (const ULandscapeLayerComponent* Layer : Component->AffectingLayers)
+	{
+		if (Layer)
+		{
+			Layer->CreateSnapshot(Job->Layers.AddDefaulted_GetRef());
+		}
+	}
 
-	// TODO: Clean up. Do I need vertex colors?
-	TArray<FColor> VertexColors;
-	// TODO: Apply layer data on VertexRunner
-	CurrentComponent->ApplyDataFromLayers(DataBuffer.HeightValues, VertexColors);
+	Landscape->GetGroundTypeWeightsForComponent(Component->Index, Job->GroundTypeWeights);
+	for (const FHeightBasedLandscapeData& HeightBasedData : Landscape->GetHeightBasedData())
+	{
+		FRuntimeLandscapeHeightGrassRule& HeightGrass = Job->HeightBasedGrass.AddDefaulted_GetRef();
+		HeightGrass.MinHeight = HeightBasedData.MinHeight;
+		HeightGrass.MaxHeight = HeightBasedData.MaxHeight;
+		HeightGrass.Grass = FRuntimeLandscapeGrassRule(HeightBasedData.Grass);
+	}
 
-	ActiveRunners = 1;
-	VertexRunner->QueueWork(DataBuffer.UV1Offset);
-	SetComponentTickEnabled(true);
+	return Job;
 }
 
-void URuntimeLandscapeRebuildManager::StartGenerateAdditionalData()
+void URuntimeLandscapeRebuildManager::RecycleJob(FRuntimeLandscapeRebuildJobPtr& Job)
 {
-	DataBuffer.RebuildState = ERuntimeLandscapeRebuildState::RLRS_BuildAdditionalData;
-	int32 VertexIndex = 0;
-	// Start data generation runners
-	ActiveRunners = Landscape->GetComponentResolution().Y + 1;
+	check(Job->ActiveRunners < 1);
+	if (Job->Buffer.IsInitialized())
+	{
+		Job->Buffer.RebuildState = ERuntimeLandscapeRebuildState::RLRS_None;
+		SpareBuffers.Add(MoveTemp(Job->Buffer));
+	}
+
+	Job.Reset();
+}
 
-	for (int32 Y = 0; Y < Landscape->GetComponentResolution().Y + 1; Y++)
+void URuntimeLandscapeRebuildManager::QueueAdditionalDataStage(const FRuntimeLandscapeRebuildJobPtr& Job,
+                                                               FQueuedThreadPool* ThreadPool)
+{
+	Job->Buffer.RebuildState = ERuntimeLandscapeRebuildState::RLRS_BuildAdditionalData;
+	// account for all runners before the first one is queued, so the job is never seen as done in between
+	Job->ActiveRunners += Job->ComponentResolution.Y + 1 + (Job->bBuildCollision ? 1 : 0);
+	FGenerateAdditionalVertexDataWorker::QueueWork(Job, ThreadPool);
+	if (Job->bBuildCollision)
 	{
-		AdditionalDataRunners[Y]->QueueWork(Y, VertexIndex, DataBuffer.UV1Offset);
-		VertexIndex += Landscape->GetComponentResolution().X + 1;
+		FGenerateCollisionWorker::QueueWork(Job, ThreadPool);
 	}
 }
 
-void URuntimeLandscapeRebuildManager::TickComponent(float DeltaTime, enum ELevelTick TickType,
-                                                    FActorComponentTickFunction* ThisTickFunction)
+void URuntimeLandscapeRebuildManager::GenerateAdaptiveTriangleArray(const FRuntimeLandscapeRebuildJob& Job,
+                                                                   FRuntimeLandscapeIndexArray& OutTriangles)
 {
-	if (ActiveRunners < 1)
-	{
-		switch (DataBuffer.RebuildState)
-		{
-		case RLRS_BuildVertices:
-			StartGenerateAdditionalData();
-			break;
-		case RLRS_BuildAdditionalData:
-			CurrentComponent->FinishRebuild(DataBuffer);
-			RebuildNextInQueue();
-			break;
-		default:
-			checkNoEntry();
+	const TArray<FVector>& Vertices = Job.Buffer.VerticesRelative;
+	const int32 VertexAmountX = Job.GetVertexAmountX();
+	const int32 VertexAmountY = Job.ComponentResolution.Y + 1;
+	auto GetIndex = [VertexAmountX](int32 X, int32 Y) { return Y * VertexAmountX + X; };
+	auto IsInHole = [&Job](int32 VertexIndex)
+	{
+		return !Job.VerticesInHole.IsEmpty() && Job.VerticesInHole.Contains(VertexIndex);
+	};
+
+	// a node is flat if all of its vertices, including the corners, are within half the tolerance of one plane
+	// the quad or fan of a leaf only uses vertices of the node, so every triangle is within half the tolerance of
+	// the plane as well and no vertex deviates more than the tolerance from the triangle that replaces it
+	auto IsFlat = [&](const FIntRect& Node)
+	{
+		const float MaxDeviation = Job.AdaptiveTolerance * 0.5f;
+		const float Z00 = Vertices[GetIndex(Node.Min.X, Node.Min.Y)].Z;
+		const float SlopeX = Vertices[GetIndex(Node.Max.X, Node.Min.Y)].Z - Z00;
+		const float SlopeY = Vertices[GetIndex(Node.Min.X, Node.Max.Y)].Z - Z00;
+		for (int32 Y = Node.Min.Y; Y <= Node.Max.Y; Y++)
+		{
+			const float V = static_cast<float>(Y - Node.Min.Y) / Node.Height();
+			for (int32 X = Node.Min.X; X <= Node.Max.X; X++)
+			{
+				const float U = static_cast<float>(X - Node.Min.X) / Node.Width();
+				const float Expected = Z00 + SlopeX * U + SlopeY * V;
+				const int32 VertexIndex = GetIndex(X, Y);
+				if (FMath::Abs(Vertices[VertexIndex].Z - Expected) > MaxDeviation || IsInHole(VertexIndex))
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	};
+
+	// all border vertices are used, so the borders always match the neighbouring components
+	TBitArray<> UsedVertices(false, Vertices.Num());
+	for (int32 X = 0; X < VertexAmountX; X++)
+	{
+		UsedVertices[GetIndex(X, 0)] = true;
+		UsedVertices[GetIndex(X, VertexAmountY - 1)] = true;
+	}
+	for (int32 Y = 0; Y < VertexAmountY; Y++)
+	{
+		UsedVertices[GetIndex(0, Y)] = true;
+		UsedVertices[GetIndex(VertexAmountX - 1, Y)] = true;
+	}
+
+	TArray<FIntRect> Leaves;
+	TArray<FIntRect> Nodes = {FIntRect(0, 0, VertexAmountX - 1, VertexAmountY - 1)};
+	while (!Nodes.IsEmpty())
+	{
+		const FIntRect Node = Nodes.Pop(false);
+		const bool bIsQuad = Node.Width() <= 1 && Node.Height() <= 1;
+		// merged nodes need a vertex inside to fan around
+		const bool bCanMerge = Node.Width() >= 2 && Node.Height() >= 2;
+		if (bIsQuad || (bCanMerge && IsFlat(Node)))
+		{
+			Leaves.Add(Node);
+			UsedVertices[GetIndex(Node.Min.X, Node.Min.Y)] = true;
+			UsedVertices[GetIndex(Node.Max.X, Node.Min.Y)] = true;
+			UsedVertices[GetIndex(Node.Min.X, Node.Max.Y)] = true;
+			UsedVertices[GetIndex(Node.Max.X, Node.Max.Y)] = true;
+			continue;
+		}
+
+		const int32 MidX = Node.Width() > 1 ? (Node.Min.X + Node.Max.X) / 2 : Node.Max.X;
+		const int32 MidY = Node.Height() > 1 ? (Node.Min.Y + Node.Max.Y) / 2 : Node.Max.Y;
+		Nodes.Add(FIntRect(Node.Min.X, Node.Min.Y, MidX, MidY));
+		if (MidX < Node.Max.X)
+		{
+			Nodes.Add(FIntRect(MidX, Node.Min.Y, Node.Max.X, MidY));
+		}
+		if (MidY < Node.Max.Y)
+		{
+			Nodes.Add(FIntRect(Node.Min.X, MidY, MidX, Node.Max.Y));
+		}
+		if (MidX < Node.Max.X && MidY < Node.Max.Y)
+		{
+			Nodes.Add(FIntRect(MidX, MidY, Node.Max.X, Node.Max.Y));
+		}
+	}
+
+	OutTriangles.Reset();
+	TArray<uint16> Border;
+	for (const FIntRect& Leaf : Leaves)
+	{
+		const uint16 T1 = GetIndex(Leaf.Min.X, Leaf.Min.Y);
+		const uint16 T2 = GetIndex(Leaf.Min.X, Leaf.Max.Y);
+		const uint16 T3 = GetIndex(Leaf.Max.X, Leaf.Min.Y);
+		const uint16 T4 = GetIndex(Leaf.Max.X, Leaf.Max.Y);
+		if (Leaf.Width() == 1 && Leaf.Height() == 1 && (IsInHole(T1) || IsInHole(T2) || IsInHole(T3) || IsInHole(T4)))
+		{
+			continue;
+		}
+
+		// walk around the leaf and collect the vertices that are used by the leaf or its neighbours
+		Border.Reset();
+		for (int32 X = Leaf.Min.X; X < Leaf.Max.X; X++)
+		{
+			Border.Add(GetIndex(X, Leaf.Min.Y));
+		}
+		for (int32 Y = Leaf.Min.Y; Y < Leaf.Max.Y; Y++)
+		{
+			Border.Add(GetIndex(Leaf.Max.X, Y));
+		}
+		for (int32 X = Leaf.Max.X; X > Leaf.Min.X; X--)
+		{
+			Border.Add(GetIndex(X, Leaf.Max.Y));
+		}
+		for (int32 Y = Leaf.Max.Y; Y > Leaf.Min.Y; Y--)
+		{
+			Border.Add(GetIndex(Leaf.Min.X, Y));
+		}
+		Border.RemoveAll([&UsedVertices](uint16 VertexIndex) { return !UsedVertices[VertexIndex]; });
+
+		if (Border.Num() == 4)
+		{
+			// same layout as GenerateTriangleArray
+			OutTriangles.Append({T1, T2, T3, T3, T2, T4});
+			continue;
+		}
+
+		const uint16 Center = GetIndex(Leaf.Min.X + Leaf.Width() / 2, Leaf.Min.Y + Leaf.Height() / 2);
+		for (int32 i = 0; i < Border.Num(); i++)
+		{
+			OutTriangles.Append({Center, Border[(i + 1) % Border.Num()], Border[i]});
 		}
 	}
 }
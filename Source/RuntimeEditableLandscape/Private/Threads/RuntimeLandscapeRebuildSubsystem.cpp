@@ -0,0 +1,456 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Threads/RuntimeLandscapeRebuildSubsystem.h"
+
+#include "RuntimeEditableLandscape.h"
+#include "RuntimeLandscapeComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
+#include "Threads/GenerateVerticesWorker.h"
+
+static TAutoConsoleVariable<int32> CVarMaxConcurrentRebuilds(
+	TEXT("RuntimeLandscape.Rebuild.MaxConcurrentRebuilds"),
+	2,
+	TEXT("The maximum amount of components that are rebuilt at the same time, across all runtime landscapes."));
+
+static TAutoConsoleVariable<float> CVarApplyBudgetMs(
+	TEXT("RuntimeLandscape.Apply.BudgetMs"),
+	2.0f,
+	TEXT("The time in milliseconds that may be spent per frame to apply finished rebuilds on the game thread.\n")
+	TEXT("At least one step is applied every frame, so rebuilds always make progress."));
+
+static TAutoConsoleVariable<int32> CVarBatchThreshold(
+	TEXT("RuntimeLandscape.Rebuild.BatchThreshold"),
+	16,
+	TEXT("If at least this many components are queued, they are rebuilt at once on the rebuild threads,\n")
+	TEXT("ignoring the concurrency limit. Their stages are chained without waiting for the game thread.\n")
+	TEXT("0 disables batch rebuilds."));
+
+static TAutoConsoleVariable<bool> CVarPrioritizeByDistance(
+	TEXT("RuntimeLandscape.Rebuild.PrioritizeByDistance"),
+	true,
+	TEXT("If enabled, queued components that are close to a local player are rebuilt first."));
+
+namespace RuntimeLandscapeRebuildSubsystem
+{
+	/** The longest time to wait for a batch component before checking the progress again, in milliseconds */
+	constexpr uint32 BatchWaitTimeoutMs = 100;
+}
+
+void URuntimeLandscapeRebuildSubsystem::QueueRebuild(URuntimeLandscapeComponent* ComponentToRebuild)
+{
+	check(IsInGameThread());
+
+	if (IsRebuilding(ComponentToRebuild))
+	{
+		// the running rebuild is superseded by the new generation and restarted as soon as its workers dropped out
+		return;
+	}
+
+	bool bIsAlreadyQueued;
+	QueuedComponents.Add(ComponentToRebuild, &bIsAlreadyQueued);
+	if (bIsAlreadyQueued)
+	{
+		return;
+	}
+
+	FRuntimeLandscapeRebuildRequest Request;
+	Request.Component = ComponentToRebuild;
+	Request.ComponentKey = ComponentToRebuild;
+	Request.Priority = CalculatePriority(ComponentToRebuild);
+	Request.SequenceNumber = NextSequenceNumber++;
+	RebuildQueue.HeapPush(Request);
+}
+
+void URuntimeLandscapeRebuildSubsystem::QueueRebuildFromAnyThread(URuntimeLandscapeComponent* ComponentToRebuild)
+{
+	if (ensure(ComponentToRebuild) && ComponentToRebuild->RebuildGeneration->TryMarkRequested())
+	{
+		FRuntimeLandscapePendingRequest Request;
+		Request.Component = ComponentToRebuild;
+		Request.Generation = ComponentToRebuild->RebuildGeneration;
+		PendingRequests.Enqueue(MoveTemp(Request));
+	}
+}
+
+void URuntimeLandscapeRebuildSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_UpdateRuntimeLandscape);
+
+	// the priorities of the drained requests already use the views of this tick
+	GatherLocalViews();
+	DrainPendingRequests();
+	// before starting rebuilds, so components that are streamed out right away are never rebuilt
+	UpdateStreaming();
+	UpdateActiveRebuilds();
+
+	const int32 BatchThreshold = CVarBatchThreshold.GetValueOnGameThread();
+	if (BatchThreshold > 0 && RebuildQueue.Num() >= BatchThreshold)
+	{
+		StartBatchRebuild();
+	}
+
+	StartQueuedRebuilds();
+	ApplyFinishedRebuilds(CVarApplyBudgetMs.GetValueOnGameThread() / 1000.0);
+	NotifyCompletedEdits();
+
+	UpdateColdComponents();
+	UpdateLODs();
+	UpdateNavigation();
+	UpdateMemoryUsage();
+}
+
+int32 URuntimeLandscapeRebuildSubsystem::StartBatchRebuild(const ARuntimeLandscape* Landscape)
+{
+	check(IsInGameThread());
+
+	// take the matching requests out of the queue
+	TArray<FRuntimeLandscapeRebuildRequest> BatchRequests;
+	for (int32 i = RebuildQueue.Num() - 1; i >= 0; --i)
+	{
+		const URuntimeLandscapeComponent* Component = RebuildQueue[i].Component.Get();
+		if (!Landscape || !Component || Component->GetParentLandscape() == Landscape)
+		{
+			QueuedComponents.Remove(RebuildQueue[i].ComponentKey);
+			BatchRequests.Add(MoveTemp(RebuildQueue[i]));
+			RebuildQueue.RemoveAtSwap(i);
+		}
+	}
+
+	RebuildQueue.Heapify();
+
+	if (!IsBatchRebuilding())
+	{
+		BatchProgress = MakeShared<FRuntimeLandscapeBatchProgress, ESPMode::ThreadSafe>();
+	}
+
+	// the batch shares the threads with the other rebuilds, so it respects their thread count
+	FQueuedThreadPool* ThreadPool = FRuntimeEditableLandscapeModule::GetRebuildThreadPool();
+	int32 StartedRebuilds = 0;
+	for (const FRuntimeLandscapeRebuildRequest& Request : BatchRequests)
+	{
+		URuntimeLandscapeComponent* Component = Request.Component.Get();
+		const ARuntimeLandscape* ComponentLandscape = Component ? Component->GetParentLandscape() : nullptr;
+		if (!ComponentLandscape)
+		{
+			continue;
+		}
+
+		FRuntimeLandscapeActiveRebuild Rebuild;
+		Rebuild.Component = Component;
+		Rebuild.Job = ComponentLandscape->GetRebuildManager()->CreateRebuildJob(Component);
+		if (!Rebuild.Job.IsValid())
+		{
+			Component->AppliedGeneration = Component->GetRebuildGeneration();
+			continue;
+		}
+
+		// counted before the job is queued, the threads may finish it right away
+		++BatchProgress->TotalComponents;
+		Rebuild.Job->BatchProgress = BatchProgress;
+		Rebuild.Job->Buffer.RebuildState = ERuntimeLandscapeRebuildState::RLRS_BuildVertices;
+		Rebuild.Job->ActiveRunners = 1;
+		FGenerateVerticesWorker::QueueWork(Rebuild.Job, ThreadPool);
+
+		ActiveRebuilds.Add(MoveTemp(Rebuild));
+		++StartedRebuilds;
+	}
+
+	UE_LOG(RuntimeEditableLandscape, Display, TEXT("Started batch rebuild of %i Landscape components..."),
+	       StartedRebuilds);
+	return StartedRebuilds;
+}
+
+bool URuntimeLandscapeRebuildSubsystem::IsBatchRebuilding() const
+{
+	return BatchProgress.IsValid() && BatchProgress->FinishedComponents < BatchProgress->TotalComponents;
+}
+
+float URuntimeLandscapeRebuildSubsystem::GetBatchProgress() const
+{
+	if (!BatchProgress.IsValid() || BatchProgress->TotalComponents == 0)
+	{
+		return 1.0f;
+	}
+
+	return static_cast<float>(BatchProgress->FinishedComponents) / BatchProgress->TotalComponents;
+}
+
+void URuntimeLandscapeRebuildSubsystem::WaitForBatchRebuild(TFunctionRef<void(float Progress)> OnProgress)
+{
+	check(IsInGameThread());
+
+	while (IsBatchRebuilding())
+	{
+		OnProgress(GetBatchProgress());
+		// woken up by every finished component, the timeout only guards against missing a notification
+		BatchProgress->ComponentFinishedEvent->Wait(RuntimeLandscapeRebuildSubsystem::BatchWaitTimeoutMs);
+	}
+
+	OnProgress(1.0f);
+
+	UpdateActiveRebuilds();
+	ApplyFinishedRebuilds(TNumericLimits<float>::Max());
+	FlushNavigationUpdates();
+	NotifyCompletedEdits();
+}
+
+void URuntimeLandscapeRebuildSubsystem::NotifyWhenComplete(const FRuntimeLandscapeEditHandle& EditHandle,
+                                                           FSimpleDelegate Callback)
+{
+	check(IsInGameThread());
+
+	if (EditHandle.IsComplete())
+	{
+		Callback.ExecuteIfBound();
+		return;
+	}
+
+	EditCallbacks.Emplace(EditHandle, MoveTemp(Callback));
+}
+
+TStatId URuntimeLandscapeRebuildSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URuntimeLandscapeRebuildSubsystem, STATGROUP_RuntimeLandscape);
+}
+
+void URuntimeLandscapeRebuildSubsystem::Deinitialize()
+{
+	// make the threads drop the work that is still in flight, they keep the jobs alive until they are done
+	for (const FRuntimeLandscapeActiveRebuild& Rebuild : ActiveRebuilds)
+	{
+		if (Rebuild.Job.IsValid())
+		{
+			Rebuild.Job->GenerationCounter->Increment();
+		}
+	}
+
+	ActiveRebuilds.Empty();
+	ApplyQueue.Empty();
+	RebuildQueue.Empty();
+	QueuedComponents.Empty();
+	EditCallbacks.Empty();
+	WarmComponents.Empty();
+
+	FRuntimeLandscapePendingRequest Request;
+	while (PendingRequests.Dequeue(Request))
+	{
+		Request.Generation->ClearRequested();
+	}
+
+	Super::Deinitialize();
+}
+
+void URuntimeLandscapeRebuildSubsystem::DrainPendingRequests()
+{
+	FRuntimeLandscapePendingRequest Request;
+	while (PendingRequests.Dequeue(Request))
+	{
+		// clear first, so requests that come in from now on are queued again
+		Request.Generation->ClearRequested();
+
+		URuntimeLandscapeComponent* Component = Request.Component.Get();
+		ARuntimeLandscape* Landscape = Component ? Component->GetParentLandscape() : nullptr;
+		if (Landscape)
+		{
+			Landscape->RequestComponentRebuild(Component);
+		}
+	}
+}
+
+void URuntimeLandscapeRebuildSubsystem::UpdateActiveRebuilds()
+{
+	for (int32 i = ActiveRebuilds.Num() - 1; i >= 0; --i)
+	{
+		if (UpdateActiveRebuild(ActiveRebuilds[i]))
+		{
+			if (ActiveRebuilds[i].Job.IsValid())
+			{
+				ApplyQueue.Add(MoveTemp(ActiveRebuilds[i]));
+			}
+			ActiveRebuilds.RemoveAtSwap(i);
+		}
+	}
+}
+
+float URuntimeLandscapeRebuildSubsystem::CalculatePriority(const URuntimeLandscapeComponent* Component) const
+{
+	if (!CVarPrioritizeByDistance.GetValueOnGameThread())
+	{
+		return 0.0f;
+	}
+
+	float Priority = LocalViews.IsEmpty() ? 0.0f : MAX_flt;
+	for (const FRuntimeLandscapeLocalView& View : LocalViews)
+	{
+		Priority = FMath::Min(Priority, FVector::DistSquared2D(View.Location, Component->Bounds.Origin));
+	}
+
+	return Priority;
+}
+
+void URuntimeLandscapeRebuildSubsystem::GatherLocalViews()
+{
+	LocalViews.Reset();
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		if (PlayerController && PlayerController->IsLocalController())
+		{
+			FRuntimeLandscapeLocalView& View = LocalViews.AddDefaulted_GetRef();
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(View.Location, ViewRotation);
+			const float FOV = PlayerController->PlayerCameraManager
+				                  ? PlayerController->PlayerCameraManager->GetFOVAngle()
+				                  : 90.0f;
+			View.FOVScale = FMath::Tan(FMath::DegreesToRadians(FOV * 0.5f));
+		}
+	}
+}
+
+void URuntimeLandscapeRebuildSubsystem::StartQueuedRebuilds()
+{
+	const int32 MaxConcurrentRebuilds = FMath::Max(1, CVarMaxConcurrentRebuilds.GetValueOnGameThread());
+
+	while (ActiveRebuilds.Num() < MaxConcurrentRebuilds && !RebuildQueue.IsEmpty())
+	{
+		FRuntimeLandscapeRebuildRequest Request;
+		RebuildQueue.HeapPop(Request);
+		QueuedComponents.Remove(Request.ComponentKey);
+
+		if (Request.Component.IsValid())
+		{
+			FRuntimeLandscapeActiveRebuild Rebuild;
+			Rebuild.Component = Request.Component;
+			if (StartRebuild(Rebuild))
+			{
+				ActiveRebuilds.Add(MoveTemp(Rebuild));
+			}
+		}
+	}
+}
+
+bool URuntimeLandscapeRebuildSubsystem::StartRebuild(FRuntimeLandscapeActiveRebuild& Rebuild)
+{
+	URuntimeLandscapeComponent* Component = Rebuild.Component.Get();
+	const ARuntimeLandscape* Landscape = Component ? Component->GetParentLandscape() : nullptr;
+	if (!Landscape)
+	{
+		return false;
+	}
+
+	UE_LOG(RuntimeEditableLandscape, Display, TEXT("Rebuilding Landscape component %s %i..."),
+	       *Landscape->GetName(), Component->GetComponentIndex());
+
+	Rebuild.Job = Landscape->GetRebuildManager()->CreateRebuildJob(Component);
+	if (!Rebuild.Job.IsValid())
+	{
+		// there is nothing that could be applied, don't keep edits waiting for it
+		Component->AppliedGeneration = Component->GetRebuildGeneration();
+		return false;
+	}
+
+	Rebuild.Job->Buffer.RebuildState = ERuntimeLandscapeRebuildState::RLRS_BuildVertices;
+	Rebuild.Job->ActiveRunners = 1;
+	FGenerateVerticesWorker::QueueWork(Rebuild.Job, FRuntimeEditableLandscapeModule::GetRebuildThreadPool());
+	return true;
+}
+
+void URuntimeLandscapeRebuildSubsystem::StartGenerateAdditionalData(FRuntimeLandscapeActiveRebuild& Rebuild)
+{
+	URuntimeLandscapeRebuildManager::QueueAdditionalDataStage(Rebuild.Job,
+	                                                          FRuntimeEditableLandscapeModule::GetRebuildThreadPool());
+}
+
+bool URuntimeLandscapeRebuildSubsystem::UpdateActiveRebuild(FRuntimeLandscapeActiveRebuild& Rebuild)
+{
+	if (Rebuild.Job->ActiveRunners > 0)
+	{
+		return false;
+	}
+
+	URuntimeLandscapeComponent* Component = Rebuild.Component.Get();
+	const ARuntimeLandscape* Landscape = Component ? Component->GetParentLandscape() : nullptr;
+	if (!Landscape)
+	{
+		// the component was destroyed while it was rebuilt
+		Rebuild.Job.Reset();
+		return true;
+	}
+
+	URuntimeLandscapeRebuildManager* RebuildManager = Landscape->GetRebuildManager();
+	if (Rebuild.Job->IsStale())
+	{
+		// the component was dirtied again while it was rebuilt -> discard the results and start over
+		UE_LOG(RuntimeEditableLandscape, Verbose, TEXT("Rebuild of Landscape component %s %i was superseded..."),
+		       *Landscape->GetName(), Component->GetComponentIndex());
+		RebuildManager->RecycleJob(Rebuild.Job);
+		return !StartRebuild(Rebuild);
+	}
+
+	switch (Rebuild.Job->Buffer.RebuildState)
+	{
+	case RLRS_BuildVertices:
+		StartGenerateAdditionalData(Rebuild);
+		return false;
+	case RLRS_BuildAdditionalData:
+		// hand over to the ApplyQueue
+		return true;
+	default:
+		checkNoEntry();
+	}
+
+	return true;
+}
+
+void URuntimeLandscapeRebuildSubsystem::ApplyFinishedRebuilds(double BudgetSeconds)
+{
+	const double EndTime = FPlatformTime::Seconds() + BudgetSeconds;
+
+	bool bHasAppliedStep = false;
+	while (!ApplyQueue.IsEmpty() && (!bHasAppliedStep || FPlatformTime::Seconds() < EndTime))
+	{
+		FRuntimeLandscapeActiveRebuild& Rebuild = ApplyQueue[0];
+		URuntimeLandscapeComponent* Component = Rebuild.Component.Get();
+		const ARuntimeLandscape* Landscape = Component ? Component->GetParentLandscape() : nullptr;
+		if (!Landscape)
+		{
+			ApplyQueue.RemoveAt(0);
+			continue;
+		}
+
+		if (Rebuild.Job->IsStale())
+		{
+			// no need to apply the remaining steps, the component is rebuilt again anyways
+			Landscape->GetRebuildManager()->RecycleJob(Rebuild.Job);
+			ApplyQueue.RemoveAt(0);
+			QueueRebuild(Component);
+			continue;
+		}
+
+		bHasAppliedStep = true;
+		if (Component->ApplyRebuildStep(*Rebuild.Job, Rebuild.ApplyState))
+		{
+			Component->AppliedGeneration = Rebuild.Job->Generation;
+			Component->LastEditTime = FPlatformTime::Seconds();
+			WarmComponents.Add(Component);
+			Landscape->GetRebuildManager()->RecycleJob(Rebuild.Job);
+			ApplyQueue.RemoveAt(0);
+		}
+	}
+}
+
+void URuntimeLandscapeRebuildSubsystem::NotifyCompletedEdits()
+{
+	for (int32 i = EditCallbacks.Num() - 1; i >= 0; --i)
+	{
+		if (EditCallbacks[i].Key.IsComplete())
+		{
+			// remove first, the callback might start a new edit
+			const FSimpleDelegate Callback = MoveTemp(EditCallbacks[i].Value);
+			EditCallbacks.RemoveAtSwap(i);
+			Callback.ExecuteIfBound();
+		}
+	}
+}
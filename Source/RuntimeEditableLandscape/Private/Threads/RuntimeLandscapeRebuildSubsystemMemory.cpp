@@ -0,0 +1,272 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Threads/RuntimeLandscapeRebuildSubsystem.h"
+
+#include "RuntimeEditableLandscape.h"
+#include "EngineUtils.h"
+#include "RuntimeLandscapeComponent.h"
+#include "RuntimeLandscapeMemoryUsage.h"
+
+static TAutoConsoleVariable<float> CVarColdComponentSeconds(
+	TEXT("RuntimeLandscape.Memory.ColdComponentSeconds"),
+	60.0f,
+	TEXT("Components that are not edited for this many seconds compress their base heights.\n")
+	TEXT("They are restored once a layer affects them again. 0 disables the compression."));
+
+static TAutoConsoleVariable<int32> CVarMaxCompressionsPerFrame(
+	TEXT("RuntimeLandscape.Memory.MaxCompressionsPerFrame"),
+	4,
+	TEXT("The maximum amount of cold components that are compressed per frame."));
+
+static TAutoConsoleVariable<float> CVarMemoryBudgetMB(
+	TEXT("RuntimeLandscape.Memory.BudgetMB"),
+	0.0f,
+	TEXT("The CPU side memory in MiB all runtime landscapes in a world may use.\n")
+	TEXT("If exceeded, caches are freed and the grass of the components furthest away is evicted.\n")
+	TEXT("0 disables the budget."));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdMemoryReport(
+	TEXT("RuntimeLandscape.Memory.Report"),
+	TEXT("Logs the memory used by the runtime landscapes. Add \"Components\" to also list every component."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const URuntimeLandscapeRebuildSubsystem* RebuildSubsystem = UWorld::GetSubsystem<
+			URuntimeLandscapeRebuildSubsystem>(World))
+		{
+			const bool bIncludeComponents = Args.ContainsByPredicate([](const FString& Arg)
+			{
+				return Arg.Equals(TEXT("Components"), ESearchCase::IgnoreCase);
+			});
+			RebuildSubsystem->LogMemoryReport(bIncludeComponents);
+		}
+	}));
+
+namespace RuntimeLandscapeRebuildSubsystem
+{
+	/** The memory stats and the budget are updated in this interval, in seconds */
+	constexpr double MemoryUpdateInterval = 1.0;
+	/** Evicted grass is only restored if the usage stays below this fraction of the budget, to avoid thrashing */
+	constexpr double GrassRestoreBudgetFraction = 0.9;
+}
+
+void URuntimeLandscapeRebuildSubsystem::UpdateColdComponents()
+{
+	const double ColdSeconds = CVarColdComponentSeconds.GetValueOnGameThread();
+	if (ColdSeconds > 0.0)
+	{
+		CompressColdComponents(ColdSeconds, CVarMaxCompressionsPerFrame.GetValueOnGameThread());
+	}
+}
+
+void URuntimeLandscapeRebuildSubsystem::CompressColdComponents(double ColdSeconds, int32 MaxCompressions)
+{
+	if (WarmComponents.IsEmpty())
+	{
+		return;
+	}
+
+	const double ColdTime = FPlatformTime::Seconds() - ColdSeconds;
+	int32 RemainingCompressions = MaxCompressions;
+	for (auto It = WarmComponents.CreateIterator(); It && RemainingCompressions > 0; ++It)
+	{
+		URuntimeLandscapeComponent* Component = It->Get();
+		if (!Component)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		if (Component->GetLastEditTime() > ColdTime || Component->HasPendingRebuild())
+		{
+			continue;
+		}
+
+		It.RemoveCurrent();
+		RemainingCompressions--;
+		Component->CompressBaseHeights();
+
+		const ARuntimeLandscape* Landscape = Component->GetParentLandscape();
+		if (Landscape && !Landscape->HasPendingRebuilds())
+		{
+			Landscape->GetRebuildManager()->TrimSpareBuffers();
+		}
+	}
+}
+
+void URuntimeLandscapeRebuildSubsystem::GetMemoryUsage(FRuntimeLandscapeMemoryUsage& OutUsage) const
+{
+	for (const TArray<FRuntimeLandscapeActiveRebuild>* Rebuilds : {&ActiveRebuilds, &ApplyQueue})
+	{
+		for (const FRuntimeLandscapeActiveRebuild& Rebuild : *Rebuilds)
+		{
+			if (Rebuild.Job.IsValid())
+			{
+				OutUsage.RebuildBuffers += Rebuild.Job->Buffer.GetAllocatedSize();
+			}
+		}
+	}
+}
+
+void URuntimeLandscapeRebuildSubsystem::LogMemoryReport(bool bIncludeComponents) const
+{
+	FRuntimeLandscapeMemoryUsage TotalUsage;
+	for (TActorIterator<ARuntimeLandscape> It(GetWorld()); It; ++It)
+	{
+		FRuntimeLandscapeMemoryUsage LandscapeUsage;
+		It->GetMemoryUsage(LandscapeUsage);
+		TotalUsage += LandscapeUsage;
+		UE_LOG(RuntimeEditableLandscape, Display, TEXT("%s: %s"), *It->GetName(), *LandscapeUsage.ToString());
+
+		if (bIncludeComponents)
+		{
+			TInlineComponentArray<URuntimeLandscapeComponent*> LandscapeComponents(*It);
+			for (URuntimeLandscapeComponent* LandscapeComponent : LandscapeComponents)
+			{
+				FRuntimeLandscapeMemoryUsage ComponentUsage;
+				LandscapeComponent->GetMemoryUsage(ComponentUsage);
+				UE_LOG(RuntimeEditableLandscape, Display, TEXT("	Component %i%s%s: %s"),
+				       LandscapeComponent->GetComponentIndex(),
+				       LandscapeComponent->IsCold() ? TEXT(" (cold)") : TEXT(""),
+				       LandscapeComponent->IsGrassEvicted() ? TEXT(" (grass evicted)") : TEXT(""),
+				       *ComponentUsage.ToString());
+			}
+		}
+	}
+
+	FRuntimeLandscapeMemoryUsage SubsystemUsage;
+	GetMemoryUsage(SubsystemUsage);
+	TotalUsage += SubsystemUsage;
+	UE_LOG(RuntimeEditableLandscape, Display,
+	       TEXT("Rebuild subsystem: %i queued, %i in flight, %i waiting to be applied, %i warm components: %s"),
+	       RebuildQueue.Num(), ActiveRebuilds.Num(), ApplyQueue.Num(), WarmComponents.Num(),
+	       *SubsystemUsage.ToString());
+	UE_LOG(RuntimeEditableLandscape, Display, TEXT("Total: %s"), *TotalUsage.ToString());
+}
+
+void URuntimeLandscapeRebuildSubsystem::UpdateMemoryUsage()
+{
+	const double CurrentTime = FPlatformTime::Seconds();
+	if (CurrentTime < NextMemoryUpdateTime)
+	{
+		return;
+	}
+
+	NextMemoryUpdateTime = CurrentTime + RuntimeLandscapeRebuildSubsystem::MemoryUpdateInterval;
+
+	const SIZE_T BudgetBytes = FMath::Max(0.0f, CVarMemoryBudgetMB.GetValueOnGameThread()) * 1024 * 1024;
+#if !STATS
+	if (BudgetBytes == 0)
+	{
+		return;
+	}
+#endif
+
+	FRuntimeLandscapeMemoryUsage Usage = CalculateMemoryUsage();
+	if (BudgetBytes > 0)
+	{
+		EnforceMemoryBudget(Usage, BudgetBytes);
+	}
+
+	SET_MEMORY_STAT(STAT_RuntimeLandscapeBaseHeightsMemory, Usage.BaseHeights);
+	SET_MEMORY_STAT(STAT_RuntimeLandscapeHolesMemory, Usage.Holes);
+	SET_MEMORY_STAT(STAT_RuntimeLandscapeMeshSectionsMemory, Usage.MeshSections);
+	SET_MEMORY_STAT(STAT_RuntimeLandscapeCollisionMemory, Usage.Collision);
+	SET_MEMORY_STAT(STAT_RuntimeLandscapeGrassMemory, Usage.Grass);
+	SET_MEMORY_STAT(STAT_RuntimeLandscapeLayerWeightsMemory, Usage.LayerWeights);
+	SET_MEMORY_STAT(STAT_RuntimeLandscapeRebuildBuffersMemory, Usage.RebuildBuffers);
+}
+
+FRuntimeLandscapeMemoryUsage URuntimeLandscapeRebuildSubsystem::CalculateMemoryUsage() const
+{
+	FRuntimeLandscapeMemoryUsage Usage;
+	for (TActorIterator<ARuntimeLandscape> It(GetWorld()); It; ++It)
+	{
+		It->GetMemoryUsage(Usage);
+	}
+
+	GetMemoryUsage(Usage);
+	return Usage;
+}
+
+void URuntimeLandscapeRebuildSubsystem::EnforceMemoryBudget(FRuntimeLandscapeMemoryUsage& Usage, SIZE_T BudgetBytes)
+{
+	TArray<URuntimeLandscapeComponent*> GrassComponents;
+	for (TActorIterator<ARuntimeLandscape> It(GetWorld()); It; ++It)
+	{
+		TInlineComponentArray<URuntimeLandscapeComponent*> LandscapeComponents(*It);
+		for (URuntimeLandscapeComponent* LandscapeComponent : LandscapeComponents)
+		{
+			if (LandscapeComponent->HasGrass() || LandscapeComponent->IsGrassEvicted())
+			{
+				GrassComponents.Add(LandscapeComponent);
+			}
+		}
+	}
+
+	// closest components first
+	TMap<const URuntimeLandscapeComponent*, float> Priorities;
+	for (const URuntimeLandscapeComponent* GrassComponent : GrassComponents)
+	{
+		Priorities.Add(GrassComponent, CalculatePriority(GrassComponent));
+	}
+
+	GrassComponents.Sort([&Priorities](const URuntimeLandscapeComponent& A, const URuntimeLandscapeComponent& B)
+	{
+		return Priorities[&A] < Priorities[&B];
+	});
+
+	if (Usage.GetTotal() <= BudgetBytes)
+	{
+		bIsOverBudget = false;
+		const double RestoreBudget = BudgetBytes * RuntimeLandscapeRebuildSubsystem::GrassRestoreBudgetFraction;
+		SIZE_T RestoredTotal = Usage.GetTotal();
+		for (URuntimeLandscapeComponent* GrassComponent : GrassComponents)
+		{
+			if (!GrassComponent->IsGrassEvicted() || !GrassComponent->IsStreamedIn()
+				|| GrassComponent->HasPendingRebuild())
+			{
+				continue;
+			}
+
+			RestoredTotal += GrassComponent->GetEvictedGrassSize();
+			if (RestoredTotal > RestoreBudget)
+			{
+				break;
+			}
+
+			GrassComponent->RequestRebuild();
+		}
+
+		return;
+	}
+
+	// caches first, they are cheap to restore
+	for (TActorIterator<ARuntimeLandscape> It(GetWorld()); It; ++It)
+	{
+		if (!It->HasPendingRebuilds())
+		{
+			It->GetRebuildManager()->TrimSpareBuffers();
+		}
+	}
+
+	CompressColdComponents(0.0, MAX_int32);
+	Usage = CalculateMemoryUsage();
+
+	for (int32 i = GrassComponents.Num() - 1; i >= 0 && Usage.GetTotal() > BudgetBytes; --i)
+	{
+		if (GrassComponents[i]->HasGrass())
+		{
+			Usage.Grass -= FMath::Min(Usage.Grass, GrassComponents[i]->EvictGrass());
+		}
+	}
+
+	const bool bWasOverBudget = bIsOverBudget;
+	bIsOverBudget = Usage.GetTotal() > BudgetBytes;
+	if (bIsOverBudget && !bWasOverBudget)
+	{
+		UE_LOG(RuntimeEditableLandscape, Warning,
+		       TEXT("The runtime landscapes use %s, which exceeds the budget of %.2f MiB."), *Usage.ToString(),
+		       BudgetBytes / (1024.0 * 1024.0));
+	}
+}
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Threads/RuntimeLandscapeRebuildSubsystem.h"
+
+#include "NavigationSystem.h"
+#include "Components/PrimitiveComponent.h"
+
+static TAutoConsoleVariable<float> CVarNavigationUpdateInterval(
+	TEXT("RuntimeLandscape.Navigation.UpdateInterval"),
+	0.5f,
+	TEXT("Navigation updates of rebuilt components are collected for this many seconds and submitted as one batch.\n")
+	TEXT("0 submits them every frame."));
+
+namespace RuntimeLandscapeRebuildSubsystem
+{
+	/** Merges overlapping areas, so the navigation tiles under them are only dirtied once */
+	void MergeOverlappingAreas(TArray<FBox>& Areas)
+	{
+		bool bHasMerged = true;
+		while (bHasMerged)
+		{
+			bHasMerged = false;
+			for (int32 i = 0; i < Areas.Num(); i++)
+			{
+				for (int32 j = Areas.Num() - 1; j > i; j--)
+				{
+					if (Areas[i].Intersect(Areas[j]))
+					{
+						Areas[i] += Areas[j];
+						Areas.RemoveAtSwap(j);
+						bHasMerged = true;
+					}
+				}
+			}
+		}
+	}
+}
+
+void URuntimeLandscapeRebuildSubsystem::QueueNavigationUpdate(UPrimitiveComponent* Component)
+{
+	if (ensure(Component))
+	{
+		PendingNavigationComponents.Add(Component);
+	}
+}
+
+void URuntimeLandscapeRebuildSubsystem::QueueNavigationDirtyArea(const FBox& DirtyArea)
+{
+	if (DirtyArea.IsValid)
+	{
+		PendingNavigationAreas.Add(DirtyArea);
+	}
+}
+
+void URuntimeLandscapeRebuildSubsystem::FlushNavigationUpdates()
+{
+	if (PendingNavigationComponents.IsEmpty() && PendingNavigationAreas.IsEmpty())
+	{
+		return;
+	}
+
+	if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
+	{
+		for (const TWeakObjectPtr<UPrimitiveComponent>& ComponentPtr : PendingNavigationComponents)
+		{
+			if (UPrimitiveComponent* Component = ComponentPtr.Get())
+			{
+				NavSys->UpdateComponentInNavOctree(*Component);
+			}
+		}
+
+		RuntimeLandscapeRebuildSubsystem::MergeOverlappingAreas(PendingNavigationAreas);
+		if (!PendingNavigationAreas.IsEmpty())
+		{
+			NavSys->AddDirtyAreas(PendingNavigationAreas, ENavigationDirtyFlag::All);
+		}
+	}
+
+	PendingNavigationComponents.Empty();
+	PendingNavigationAreas.Empty();
+}
+
+void URuntimeLandscapeRebuildSubsystem::UpdateNavigation()
+{
+	const double CurrentTime = FPlatformTime::Seconds();
+	if (CurrentTime < NextNavigationUpdateTime)
+	{
+		return;
+	}
+
+	NextNavigationUpdateTime = CurrentTime + FMath::Max(0.0f, CVarNavigationUpdateInterval.GetValueOnGameThread());
+	FlushNavigationUpdates();
+}
@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Threads/RuntimeLandscapeRebuildSubsystem.h"
+
+#include "EngineUtils.h"
+#include "RuntimeLandscapeComponent.h"
+
+static TAutoConsoleVariable<bool> CVarEnableLODs(
+	TEXT("RuntimeLandscape.LOD.Enable"),
+	true,
+	TEXT("If disabled, all components are rendered at full resolution."));
+
+static TAutoConsoleVariable<int32> CVarMaxLODBuildsPerFrame(
+	TEXT("RuntimeLandscape.LOD.MaxBuildsPerFrame"),
+	4,
+	TEXT("The maximum amount of LOD changes that are started per frame, closest components first.\n")
+	TEXT("The LOD meshes are generated on the rebuild threads."));
+
+static TAutoConsoleVariable<int32> CVarLODEvaluationsPerFrame(
+	TEXT("RuntimeLandscape.LOD.EvaluationsPerFrame"),
+	64,
+	TEXT("The amount of components whose screen size is checked per frame, one after another.\n")
+	TEXT("0 checks all components every frame."));
+
+void URuntimeLandscapeRebuildSubsystem::UpdateStreaming()
+{
+	// without a view, i.e. in the editor, the components keep their current state
+	if (LocalViews.IsEmpty())
+	{
+		return;
+	}
+
+	for (TActorIterator<ARuntimeLandscape> It(GetWorld()); It; ++It)
+	{
+		const ARuntimeLandscape* Landscape = *It;
+		if (!Landscape->bEnableStreaming)
+		{
+			continue;
+		}
+
+		const float StreamInDistanceSquared = FMath::Square(Landscape->StreamingRadius);
+		const float StreamOutDistanceSquared = FMath::Square(
+			Landscape->StreamingRadius + Landscape->StreamingHysteresis);
+		for (URuntimeLandscapeComponent* LandscapeComponent : Landscape->GetLandscapeComponents())
+		{
+			if (!LandscapeComponent)
+			{
+				continue;
+			}
+
+			// the mesh bounds are empty while streamed out, the component starts at its location
+			const FBox2D LocalBounds = Landscape->GetComponentBounds(LandscapeComponent->GetComponentIndex());
+			const FBox2D ComponentBox2D = LocalBounds.ShiftBy(
+				FVector2D(LandscapeComponent->GetComponentLocation()) - LocalBounds.Min);
+			float DistanceSquared = MAX_flt;
+			for (const FRuntimeLandscapeLocalView& View : LocalViews)
+			{
+				DistanceSquared = FMath::Min(DistanceSquared,
+				                             ComponentBox2D.ComputeSquaredDistanceToPoint(FVector2D(View.Location)));
+			}
+
+			if (LandscapeComponent->IsStreamedIn() && DistanceSquared > StreamOutDistanceSquared)
+			{
+				LandscapeComponent->StreamOut();
+			}
+			else if (!LandscapeComponent->IsStreamedIn() && DistanceSquared <= StreamInDistanceSquared)
+			{
+				LandscapeComponent->StreamIn();
+			}
+		}
+	}
+}
+
+void URuntimeLandscapeRebuildSubsystem::UpdateLODs()
+{
+	// with the LODs disabled, all components are treated like without a view
+	TArrayView<const FRuntimeLandscapeLocalView> Views;
+	if (CVarEnableLODs.GetValueOnGameThread())
+	{
+		Views = LocalViews;
+	}
+
+	// swap in the LOD meshes the rebuild threads are done with, the others are checked again next frame
+	for (int32 i = ActiveLODBuilds.Num() - 1; i >= 0; i--)
+	{
+		URuntimeLandscapeComponent* LandscapeComponent = ActiveLODBuilds[i].Get();
+		if (!LandscapeComponent || !LandscapeComponent->HasLODBuild() || LandscapeComponent->ApplyLODBuild())
+		{
+			ActiveLODBuilds.RemoveAtSwap(i);
+		}
+	}
+
+	if (NextLODComponent >= LODComponents.Num())
+	{
+		// start the next round, this also picks up components that were added in the meantime
+		NextLODComponent = 0;
+		LODComponents.Reset();
+		for (TActorIterator<ARuntimeLandscape> It(GetWorld()); It; ++It)
+		{
+			for (URuntimeLandscapeComponent* LandscapeComponent : It->GetLandscapeComponents())
+			{
+				LODComponents.Add(LandscapeComponent);
+			}
+		}
+	}
+
+	const int32 EvaluationsPerFrame = CVarLODEvaluationsPerFrame.GetValueOnGameThread();
+	const int32 LastLODComponent = EvaluationsPerFrame > 0
+		                               ? FMath::Min(NextLODComponent + EvaluationsPerFrame, LODComponents.Num())
+		                               : LODComponents.Num();
+	for (; NextLODComponent < LastLODComponent; NextLODComponent++)
+	{
+		URuntimeLandscapeComponent* LandscapeComponent = LODComponents[NextLODComponent].Get();
+		if (!LandscapeComponent || LandscapeComponent->GetNumSections() == 0)
+		{
+			continue;
+		}
+
+		// without a view, i.e. in the editor, everything is shown at full resolution
+		float ScreenSize = Views.IsEmpty() ? MAX_flt : 0.0f;
+		for (const FRuntimeLandscapeLocalView& View : Views)
+		{
+			const float Distance = FVector::Dist(View.Location, LandscapeComponent->Bounds.Origin);
+			ScreenSize = FMath::Max(ScreenSize, LandscapeComponent->Bounds.SphereRadius
+			                        / FMath::Max(1.0f, Distance * View.FOVScale));
+		}
+
+		if (LandscapeComponent->GetParentLandscape()->GetLODForScreenSize(ScreenSize) == LandscapeComponent->GetLOD())
+		{
+			PendingLODChanges.Remove(LandscapeComponent);
+		}
+		else
+		{
+			PendingLODChanges.Add(LandscapeComponent, ScreenSize);
+		}
+	}
+
+	// every change uploads the LOD mesh again, the closest components switch first
+	PendingLODChanges.ValueSort(TGreater<float>());
+	int32 NumLODBuilds = 0;
+	const int32 MaxLODBuilds = FMath::Max(1, CVarMaxLODBuildsPerFrame.GetValueOnGameThread());
+	for (auto It = PendingLODChanges.CreateIterator(); It && NumLODBuilds < MaxLODBuilds; ++It)
+	{
+		URuntimeLandscapeComponent* LandscapeComponent = It->Key.Get();
+		if (LandscapeComponent && LandscapeComponent->HasLODBuild())
+		{
+			// the LOD that is generated is swapped in first, the component is checked again afterwards
+			continue;
+		}
+
+		if (LandscapeComponent && LandscapeComponent->RequestLOD(
+			LandscapeComponent->GetParentLandscape()->GetLODForScreenSize(It->Value)))
+		{
+			// LOD 0 is switched immediately, the other LODs are swapped in once they are generated
+			if (LandscapeComponent->HasLODBuild())
+			{
+				ActiveLODBuilds.Add(LandscapeComponent);
+			}
+			NumLODBuilds++;
+		}
+		It.RemoveCurrent();
+	}
+}
@@ -3,11 +3,12 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "RuntimeLandscapeEditHandle.h"
 #include "Components/ActorComponent.h"
+#include "LayerTypes/LandscapeLayerDataBase.h"
 #include "LandscapeLayerComponent.generated.h"
 
 
-class ULandscapeLayerDataBase;
 class URuntimeLandscapeComponent;
 class ARuntimeLandscape;
 
@@ -27,6 +28,49 @@ enum ELayerShape : uint8
 	HS_Round UMETA(DisplayName = "Round")
 };
 
+/**
+ * The area affected by a layer
+ * A plain copy of the shape, so it can be evaluated by the rebuild threads without the layer component
+ */
+struct FLandscapeLayerFootprint
+{
+	TEnumAsByte<ELayerShape> Shape = ELayerShape::HS_Box;
+	/** The transform of the bounds, boxes are rotated with it */
+	FTransform Transform = FTransform::Identity;
+	FVector2D Origin = FVector2D::ZeroVector;
+	float Radius = 0.0f;
+	float SmoothingDistance = 0.0f;
+	/** The axis aligned bounding box */
+	FBox2D BoundingBox = FBox2D();
+	/** The affected box without smoothing */
+	FBox2D InnerBox = FBox2D();
+	float BoundsSmoothingOffset = 0.0f;
+	float InnerSmoothingOffset = 0.0f;
+
+	/**
+	 * Try to calculate the smoothing distance
+	 * @param OutSmoothingFactor the resulting smoothing factor
+	 * @param Location the location to calculate the distance to  
+	 * @return true if the location is affected
+	 */
+	bool TryCalculateSmoothingFactor(float& OutSmoothingFactor, const FVector2D& Location) const;
+	/** Returns true if the location is affected, uses the exact shape instead of the bounding box */
+	bool IsInside(const FVector2D& Location) const;
+
+private:
+	bool TryCalculateBoxSmoothingFactor(float& OutSmoothingFactor, const FVector2D& Location) const;
+	bool TryCalculateSphereSmoothingFactor(float& OutSmoothingFactor, const FVector2D& Location) const;
+};
+
+/**
+ * Everything the rebuild threads need to apply a layer to the vertices of a component
+ */
+struct FLandscapeLayerSnapshot
+{
+	FLandscapeLayerFootprint Footprint;
+	TArray<FLandscapeLayerVertexEffect> Effects;
+};
+
 UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
 class RUNTIMEEDITABLELANDSCAPE_API ULandscapeLayerComponent : public UActorComponent
 {
@@ -51,13 +95,20 @@ public:
 	FORCEINLINE ELayerShape GetShape() const { return Shape; }
 	FORCEINLINE float GetRadius() const { return Radius; }
 	FORCEINLINE const FVector& GetExtent() const { return Extent; }
-	FORCEINLINE const FBox2D& GetBoundingBox() const { return BoundingBox; }
+	FORCEINLINE const FBox2D& GetBoundingBox() const { return Footprint.BoundingBox; }
+	FORCEINLINE const FLandscapeLayerFootprint& GetFootprint() const { return Footprint; }
 	FORCEINLINE const TSet<const ULandscapeLayerDataBase*>& GetLayerData() const { return Layers; }
 
-	void ApplyToLandscape();
+	/**
+	 * Applies the layer to all affected landscapes
+	 * @return Handle that completes once the layer is visible on all affected landscape components
+	 */
+	FRuntimeLandscapeEditHandle ApplyToLandscape();
 	bool IsAffectedByLayer(FVector2D Location) const;
-	void ApplyLayerData(int32 VertexIndex, URuntimeLandscapeComponent* LandscapeComponent, float& OutHeightValue,
-	                    FColor& OutVertexColorValue) const;
+	/** Returns true if the layer has any effect at the location, uses the exact shape instead of the bounding box */
+	bool IsInsideFootprint(const FVector2D& Location) const;
+	/** Captures the footprint and the vertex effects of the layer for the rebuild threads */
+	void CreateSnapshot(FLandscapeLayerSnapshot& OutSnapshot) const;
 	void SetBoundsComponent(UPrimitiveComponent* NewBoundsComponent);
 
 protected:
@@ -84,23 +135,8 @@ protected:
 	 */
 	TObjectPtr<UPrimitiveComponent> BoundsComponent;
 
-	/** The axis aligned bounding box */
-	FBox2D BoundingBox = FBox2D();
-	/** The affected box without smoothing */
-	FBox2D InnerBox = FBox2D();
-	float BoundsSmoothingOffset = 0.0f;
-	float InnerSmoothingOffset = 0.0f;
-
-	/**
-	 * Try to calculate the smoothing distance
-	 * @param OutSmoothingFactor the resulting smoothing factor
-	 * @param Location the location to calculate the distance to  
-	 * @return true if the location is affected
-	 */
-	bool TryCalculateSmoothingFactor(float& OutSmoothingFactor, const FVector2D& Location) const;
-	bool TryCalculateBoxSmoothingFactor(float& OutSmoothingFactor, const FVector2D& Location, FVector2D Origin) const;
-	bool TryCalculateSphereSmoothingFactor(float& OutSmoothingFactor, const FVector2D& Location,
-	                                       FVector2D Origin) const;
+	/** The affected area, updated with the shape */
+	FLandscapeLayerFootprint Footprint;
 
 	void HandleBoundsChanged(USceneComponent* SceneComponent, EUpdateTransformFlags UpdateTransformFlags,
 	                         ETeleportType Teleport);
@@ -18,5 +18,6 @@ protected:
 	UPROPERTY(EditAnywhere)
 	float HeightValue;
 	
-	virtual void ApplyToVertices(URuntimeLandscapeComponent* LandscapeComponent, const ULandscapeLayerComponent* LayerComponent, int32 VertexIndex, float& OutHeightValue, FColor& OutVertexColor, float SmoothingFactor) const override;
+	virtual bool GetVertexEffect(const ULandscapeLayerComponent* LayerComponent,
+	                             FLandscapeLayerVertexEffect& OutEffect) const override;
 };
@@ -7,7 +7,24 @@
 #include "LandscapeLayerDataBase.generated.h"
 
 class ARuntimeLandscape;
-class URuntimeLandscapeComponent;
+class ULandscapeLayerComponent;
+
+enum class ELandscapeLayerVertexEffect : uint8
+{
+	Height,
+	Hole
+};
+
+/**
+ * The effect of a layer on the vertices, captured on the game thread and applied by the rebuild threads
+ */
+struct FLandscapeLayerVertexEffect
+{
+	ELandscapeLayerVertexEffect Type = ELandscapeLayerVertexEffect::Height;
+	/** Height: the height the vertices are moved to, Hole: vertices with a smaller smoothing factor are holes */
+	float Value = 0.0f;
+};
+
 /**
  * Base class for landscape layers
  */
@@ -25,10 +42,14 @@ protected:
 	{
 	}
 
-	/** Override this for effects that apply their effect based on vertices */
-	virtual void ApplyToVertices(URuntimeLandscapeComponent* LandscapeComponent,
-	                             const ULandscapeLayerComponent* LayerComponent, int32 VertexIndex,
-	                             float& OutHeightValue, FColor& OutVertexColor, float SmoothingFactor) const
+	/**
+	 * Override this for effects that apply their effect based on vertices
+	 * Called on the game thread when a rebuild is started, the effect is applied by the rebuild threads
+	 * @return false if the layer doesn't affect the vertices
+	 */
+	virtual bool GetVertexEffect(const ULandscapeLayerComponent* LayerComponent,
+	                             FLandscapeLayerVertexEffect& OutEffect) const
 	{
+		return false;
 	}
 };
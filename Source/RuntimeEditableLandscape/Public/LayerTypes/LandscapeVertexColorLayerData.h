@@ -8,6 +8,7 @@
 
 /**
  * Landscape layer that affects vertex colors
+ * NOTE: The landscape mesh doesn't use vertex colors yet, so this layer has no effect
  */
 UCLASS(EditInlineNew)
 class RUNTIMEEDITABLELANDSCAPE_API ULandscapeVertexColorLayerData : public ULandscapeLayerDataBase
@@ -17,11 +18,4 @@ class RUNTIMEEDITABLELANDSCAPE_API ULandscapeVertexColorLayerData : public ULand
 protected:
 	UPROPERTY(EditAnywhere)
 	FColor VertexColor;
-
-	virtual void ApplyToVertices(URuntimeLandscapeComponent* LandscapeComponent, const ULandscapeLayerComponent* LayerComponent,
-	                   int32 VertexIndex, float& OutHeightValue, FColor& OutVertexColor,
-	                   float SmoothingFactor) const override
-	{
-		OutVertexColor = FLinearColor::LerpUsingHSV(VertexColor, OutVertexColor, SmoothingFactor).ToFColor(false);
-	}
 };
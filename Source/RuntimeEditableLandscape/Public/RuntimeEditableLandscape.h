@@ -5,11 +5,21 @@
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
 
+class FQueuedThreadPool;
+
 DECLARE_LOG_CATEGORY_EXTERN(RuntimeEditableLandscape, Display, Display);
 
 DECLARE_STATS_GROUP(TEXT("Stats for the runtime editable landscape"), STATGROUP_RuntimeLandscape, STATCAT_Advanced)
 DECLARE_CYCLE_STAT(TEXT("Update runtime landscape"), STAT_UpdateRuntimeLandscape, STATGROUP_RuntimeLandscape)
 DECLARE_CYCLE_STAT(TEXT("Add landscape layer"), STAT_AddLandscapeLayer, STATGROUP_RuntimeLandscape)
+DECLARE_CYCLE_STAT(TEXT("Update landscape foliage"), STAT_UpdateLandscapeFoliage, STATGROUP_RuntimeLandscape)
+DECLARE_MEMORY_STAT(TEXT("Base heights"), STAT_RuntimeLandscapeBaseHeightsMemory, STATGROUP_RuntimeLandscape)
+DECLARE_MEMORY_STAT(TEXT("Holes"), STAT_RuntimeLandscapeHolesMemory, STATGROUP_RuntimeLandscape)
+DECLARE_MEMORY_STAT(TEXT("Mesh sections"), STAT_RuntimeLandscapeMeshSectionsMemory, STATGROUP_RuntimeLandscape)
+DECLARE_MEMORY_STAT(TEXT("Collision"), STAT_RuntimeLandscapeCollisionMemory, STATGROUP_RuntimeLandscape)
+DECLARE_MEMORY_STAT(TEXT("Grass"), STAT_RuntimeLandscapeGrassMemory, STATGROUP_RuntimeLandscape)
+DECLARE_MEMORY_STAT(TEXT("Layer weights"), STAT_RuntimeLandscapeLayerWeightsMemory, STATGROUP_RuntimeLandscape)
+DECLARE_MEMORY_STAT(TEXT("Rebuild buffers"), STAT_RuntimeLandscapeRebuildBuffersMemory, STATGROUP_RuntimeLandscape)
 
 class FRuntimeEditableLandscapeModule : public IModuleInterface
 {
@@ -18,4 +28,10 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+	/** The thread pool that is shared by all runtime landscapes, created on first use */
+	static FQueuedThreadPool* GetRebuildThreadPool();
+
+private:
+	static FQueuedThreadPool* RebuildThreadPool;
 };
@@ -4,10 +4,17 @@
 
 #include "CoreMinimal.h"
 #include "LandscapeGroundTypeData.h"
+#include "LandscapeLayerComponent.h"
+#include "RuntimeLandscapeEditHandle.h"
 #include "GameFramework/Actor.h"
 #include "RuntimeLandscape.generated.h"
 
 class URuntimeLandscapeRebuildManager;
+class URuntimeLandscapeGrassManager;
+class URuntimeLandscapeBakedData;
+struct FRuntimeLandscapeBakedContents;
+struct FRuntimeLandscapeMemoryUsage;
+struct FRuntimeLandscapeGroundTypeWeights;
 class UTextureRenderTarget;
 enum ELayerShape : uint8;
 class URuntimeLandscapeComponent;
@@ -15,6 +22,22 @@ class ULandscapeLayerComponent;
 class ALandscape;
 
 class UProceduralMeshComponent;
+class UHierarchicalInstancedStaticMeshComponent;
+
+/**
+ * Foliage instances a layer removed, so they can be added again once the layer is moved or removed
+ */
+struct FRuntimeLandscapeRemovedFoliage
+{
+	/** World transforms of the removed instances per foliage type */
+	TMap<TWeakObjectPtr<UHierarchicalInstancedStaticMeshComponent>, TArray<FTransform>> Instances;
+	/** The footprint the foliage was removed with, unset until the first update of the layer is applied */
+	TOptional<FLandscapeLayerFootprint> Footprint;
+	/** The latest queued update of the layer */
+	uint32 QueuedUpdate = 0;
+	/** The latest applied update, updates that finish after a later one are dropped */
+	uint32 AppliedUpdate = 0;
+};
 
 USTRUCT(Blueprintable)
 struct FGroundTypeBrushData
@@ -96,6 +119,28 @@ struct FHeightBasedLandscapeData
 	FGrassTypeSettings Grass;
 };
 
+USTRUCT()
+/**
+ * Settings to create a landscape from a 16 bit heightmap
+ */
+struct FRuntimeLandscapeHeightmapImportSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, meta = (FilePathFilter = "Heightmap (*.r16;*.raw;*.png)|*.r16;*.raw;*.png"))
+	/** Raw 16 bit little endian samples (square) or a 16 bit grayscale PNG */
+	FFilePath File;
+	UPROPERTY(EditAnywhere, meta = (ClampMin = 1, ClampMax = 255))
+	/**
+	 * The amount of quads per component side, the heightmap resolution - 1 has to be a multiple of it
+	 * Limited to 255 like the landscape components, so 16 bit indices can be used
+	 */
+	int32 ComponentSizeQuads = 63;
+	UPROPERTY(EditAnywhere)
+	/** Same as the scale of an ALandscape, X is used as distance between the vertices */
+	FVector Scale = FVector(100.0f);
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnRuntimeLandscapeInitialized, ARuntimeLandscape*, InitializedLandscape);
 
 UCLASS(Blueprintable, BlueprintType)
@@ -113,25 +158,116 @@ public:
 	uint32 bGenerateOverlapEvents : 1;
 	UPROPERTY(EditAnywhere, Category = "Performance")
 	uint8 bUpdateCollision : 1 = 1;
+	UPROPERTY(EditAnywhere, Category = "Performance", meta = (EditCondition = "bUpdateCollision"))
+	/**
+	 * Uses a Chaos heightfield built from the heights as collision instead of cooking a triangle mesh
+	 * Edits only update the rectangle of the heightfield that changed
+	 */
+	uint8 bUseHeightFieldCollision : 1 = 1;
+	UPROPERTY(EditAnywhere, Category = "Performance", meta = (ClampMin = 0, ClampMax = 4,
+		EditCondition = "bUpdateCollision && bUseHeightFieldCollision"))
+	/**
+	 * Every level halves the resolution of the heightfield collision compared to the mesh
+	 * Limited to levels that divide the quads of a component evenly
+	 */
+	int32 CollisionMipLevel = 0;
 	UPROPERTY(EditAnywhere, Category = "Performance")
 	/**
 	 * Whether landscape updates at runtime should affect navigation
 	 * NOTE: Requires 'Navigation Mesh->Runtime->Runtime Generation->Dynamic' in the project settings
 	 */
 	uint8 bUpdateNavigation : 1 = 1;
+	UPROPERTY(EditAnywhere, Category = "Performance", meta = (ClampMin = 0))
+	/**
+	 * Merges quads into larger triangles while their heights deviate less than this from the merged surface
+	 * Reduces the triangles for rendering, collision and navigation on flat areas, 0 disables the merging
+	 * The borders of the components keep all vertices, so neighbouring components always match
+	 */
+	float AdaptiveTriangulationTolerance = 0.0f;
+	UPROPERTY(EditAnywhere, Category = "Performance", meta = (ClampMin = 1))
+	/**
+	 * The side length of the cells the grass is grouped into, every cell has a single instanced mesh per grass mesh
+	 * Components belong to the cell that contains their center
+	 */
+	float GrassCellSize = 25600.0f;
+	UPROPERTY(EditAnywhere, Category = "LOD")
+	/**
+	 * Every entry adds a LOD with half the resolution of the previous one
+	 * A LOD is used once the screen size of a component drops below its entry, sorted from large to small
+	 */
+	TArray<float> LODScreenSizes = {0.5f, 0.25f, 0.125f};
+	UPROPERTY(EditAnywhere, Category = "LOD", meta = (ClampMin = 0))
+	/** How far the skirts reach below the borders of the components, hides the cracks between different LODs */
+	float LODSkirtDepth = 100.0f;
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+	/**
+	 * Only keep the meshes and grass of the components close to the local players
+	 * Layers still apply to components that are streamed out, they are up to date once they are streamed in again
+	 */
+	bool bEnableStreaming = false;
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (EditCondition = "bEnableStreaming", ClampMin = 0))
+	/** Components closer than this to a local player are streamed in */
+	float StreamingRadius = 50000.0f;
+	UPROPERTY(EditAnywhere, Category = "Streaming", meta = (EditCondition = "bEnableStreaming", ClampMin = 0))
+	/** Components are streamed out once they are this much further away than the streaming radius */
+	float StreamingHysteresis = 5000.0f;
 
 	FOnRuntimeLandscapeInitialized OnLandscapeInitialized;
 
+	/**
+	 * Replaces all components with the heights from a 16 bit heightmap, does not need a parent landscape
+	 * @param FilePath				Raw 16 bit little endian samples (square) or a 16 bit grayscale PNG
+	 * @param ComponentSizeQuads	The amount of quads per component side
+	 * @param Scale					Same as the scale of an ALandscape, X is used as distance between the vertices
+	 * @return false if the heightmap could not be read or does not fit the component size
+	 */
+	bool InitializeFromHeightmap(const FString& FilePath, int32 ComponentSizeQuads, const FVector& Scale);
+
 	/**
 	 * Adds a new layer to the landscape
 	 * @param LayerToAdd The added landscape layer
+	 * @return Handle that completes once the layer is applied to all affected components
 	 */
-	void AddLandscapeLayer(const ULandscapeLayerComponent* LayerToAdd);
+	FRuntimeLandscapeEditHandle AddLandscapeLayer(const ULandscapeLayerComponent* LayerToAdd);
 	void DrawGroundType(const ULandscapeGroundTypeData* GroundType, ELayerShape Shape, const FTransform& WorldTransform,
 	                    const FVector& BrushExtent);
-	void RemoveLandscapeLayer(const ULandscapeLayerComponent* Layer);
+	/**
+	 * Applies the layer after it moved, only the components covered before or after the move are rebuilt
+	 * @param Layer The moved landscape layer, its shape is already updated
+	 * @param PreviousBounds The bounding box of the layer before the move
+	 * @return Handle that completes once the moved layer is applied to all affected components
+	 */
+	FRuntimeLandscapeEditHandle MoveLandscapeLayer(const ULandscapeLayerComponent* Layer, const FBox2D& PreviousBounds);
+	/**
+	 * Removes the layer from all components it affects
+	 * @return Handle that completes once the layer is gone from all affected components
+	 */
+	FRuntimeLandscapeEditHandle RemoveLandscapeLayer(const ULandscapeLayerComponent* Layer);
+
+	UFUNCTION(BlueprintCallable)
+	/**
+	 * Starts an edit transaction, until it ends all layer changes only mark the affected components as dirty
+	 * Transactions can be nested, the changes are committed when the outermost transaction ends
+	 */
+	void BeginEdit();
+	UFUNCTION(BlueprintCallable)
+	/**
+	 * Ends the edit transaction and rebuilds every dirty component exactly once
+	 * @return Handle that completes once all changes of the transaction are applied
+	 */
+	FRuntimeLandscapeEditHandle EndEdit();
+	FORCEINLINE bool IsEditing() const { return EditDepth > 0; }
+	/** Queues a rebuild of the component, or defers it until the current edit transaction ends */
+	void RequestComponentRebuild(URuntimeLandscapeComponent* Component);
 	TMap<const ULandscapeGroundTypeData*, float> GetGroundTypeLayerWeightsAtVertexCoordinates(
 		int32 SectionIndex, int32 X, int32 Y) const;
+	/**
+	 * Copies the ground type layer weights of all vertices in the component
+	 * @param SectionIndex	The id of the component
+	 * @param OutWeights	One entry per ground type layer set
+	 */
+	void GetGroundTypeWeightsForComponent(int32 SectionIndex,
+	                                      TArray<FRuntimeLandscapeGroundTypeWeights>& OutWeights) const;
 
 	/** Get the amount of vertices in a single component */
 	FORCEINLINE int32 GetTotalVertexAmountPerComponent() const
@@ -145,12 +281,19 @@ public:
 	}
 
 	FORCEINLINE URuntimeLandscapeRebuildManager* GetRebuildManager() const { return RebuildManager; }
+	FORCEINLINE URuntimeLandscapeGrassManager* GetGrassManager() const { return GrassManager; }
+	FORCEINLINE const TArray<TObjectPtr<URuntimeLandscapeComponent>>& GetLandscapeComponents() const
+	{
+		return LandscapeComponents;
+	}
 	FORCEINLINE const FVector2D& GetLandscapeSize() const { return LandscapeSize; }
 	FORCEINLINE const FVector2D& GetMeshResolution() const { return MeshResolution; }
 	FORCEINLINE const FVector2D& GetComponentAmount() const { return ComponentAmount; }
 	FORCEINLINE const FVector2D& GetComponentResolution() const { return ComponentResolution; }
 	FORCEINLINE float GetQuadSideLength() const { return QuadSideLength; }
 	FORCEINLINE float GetParentHeight() const { return ParentHeight; }
+	/** The range the base heights of all components are quantized with, without the parent height */
+	FORCEINLINE const FFloatInterval& GetBaseHeightRange() const { return BaseHeightRange; }
 	FORCEINLINE float GetAreaPerSquare() const { return AreaPerSquare; }
 	FORCEINLINE TArray<FHeightBasedLandscapeData> GetHeightBasedData() const { return HeightBasedData; }
 	FORCEINLINE const AInstancedFoliageActor* GetFoliageActor() const { return FoliageActor; }
@@ -209,10 +352,21 @@ public:
 	FBox2D GetComponentBounds(int32 SectionIndex) const;
 	/** Returns true if the landscape is fully initialized -> the parent Landscape is destroyed */
 	bool IsInitialized() const { return ParentLandscape == nullptr; }
+	/** Returns true if any component was dirtied and the rebuild is not applied yet */
+	bool HasPendingRebuilds() const;
+	/** The amount of LODs including the full resolution, limited by the resolution of the components */
+	int32 GetNumLODs() const;
+	int32 GetLODForScreenSize(float ScreenSize) const;
+	/** The distance between the heightfield collision samples in vertices */
+	int32 GetCollisionStride() const;
+	/** Adds the CPU side memory used by the landscape and its components */
+	void GetMemoryUsage(FRuntimeLandscapeMemoryUsage& OutUsage) const;
 
 protected:
 	UPROPERTY()
 	TObjectPtr<URuntimeLandscapeRebuildManager> RebuildManager;
+	UPROPERTY()
+	TObjectPtr<URuntimeLandscapeGrassManager> GrassManager;
 	UPROPERTY(EditAnywhere)
 	/** The base for scaling landscape height (8 bit?) */
 	int32 HeightValueBits = 7;
@@ -235,6 +389,14 @@ protected:
 	TMap<TEnumAsByte<ELayerShape>, FGroundTypeBrushData> GroundTypeBrushes;
 	UPROPERTY(EditAnywhere)
 	bool bBakeLayersOnBeginPlay = true;
+	UPROPERTY(EditAnywhere, Category = "Heightmap Import")
+	FRuntimeLandscapeHeightmapImportSettings HeightmapImportSettings;
+	UPROPERTY(VisibleAnywhere, Category = "Baking")
+	/**
+	 * Binary cache of the baked heights and ground type weights, created by BakeToBinaryCache
+	 * If set, the landscape is initialized from it and neither needs the parent landscape nor a weightmap bake
+	 */
+	TObjectPtr<URuntimeLandscapeBakedData> BakedData;
 	UPROPERTY()
 	/** The area a single square occupies */
 	float AreaPerSquare;
@@ -260,6 +422,9 @@ protected:
 	float QuadSideLength;
 	UPROPERTY()
 	float ParentHeight;
+	UPROPERTY()
+	/** Shared by all components, so the heights at their borders are restored to the same values */
+	FFloatInterval BaseHeightRange;
 	UPROPERTY(EditAnywhere)
 	TObjectPtr<ALandscape> ParentLandscape;
 	UPROPERTY(EditAnywhere)
@@ -271,8 +436,24 @@ protected:
 
 	bool bIsRebuilding;
 
+	/** The amount of nested edit transactions */
+	int32 EditDepth = 0;
+	/** Components that were changed during the current edit transaction */
+	TSet<TWeakObjectPtr<URuntimeLandscapeComponent>> DirtyComponents;
+	/** Indices of the ground layer sets that were drawn to during the current edit transaction */
+	TSet<int32> DirtyLayerSets;
+	/** Foliage removed by each layer */
+	TMap<TObjectKey<ULandscapeLayerComponent>, FRuntimeLandscapeRemovedFoliage> RemovedFoliage;
+	/** Orders the foliage updates of the layers */
+	uint32 LastFoliageUpdate = 0;
+
 	UFUNCTION(BlueprintCallable)
 	void InitializeFromLandscape();
+	UFUNCTION(CallInEditor, Category = "Heightmap Import")
+	void ImportHeightmap();
+	UFUNCTION(CallInEditor, Category = "Baking")
+	/** Bakes the layers of the parent landscape and stores them together with the heights in the BakedData */
+	void BakeToBinaryCache();
 	UFUNCTION(BlueprintCallable)
 	void BakeLandscapeLayers();
 
@@ -281,11 +462,50 @@ protected:
 	UFUNCTION()
 	void BakeLandscapeLayersAndDestroyLandscape();
 
+	/**
+	 * Updates the foliage of the layer once the edit is applied, so it changes together with the terrain
+	 * @param Layer The added, moved or removed layer
+	 * @param EditHandle The edit of the components affected by the layer
+	 * @param bIsRemoved If true, all foliage removed by the layer is added again
+	 */
+	void QueueFoliageUpdate(const ULandscapeLayerComponent* Layer, const FRuntimeLandscapeEditHandle& EditHandle,
+	                        bool bIsRemoved);
+	/**
+	 * Adds the recorded foliage outside of the new footprint again and removes the foliage that is only inside the
+	 * new footprint, a single removal and addition per foliage type
+	 * @param Footprint The new footprint of the layer, unset if the layer is removed
+	 */
+	void UpdateFoliageOfLayer(TObjectKey<ULandscapeLayerComponent> LayerKey,
+	                          const TOptional<FLandscapeLayerFootprint>& Footprint, uint32 Update);
+	/** Adds the removed foliage again, unless the footprint of another layer covers it */
+	void RestoreFoliage(TObjectKey<ULandscapeLayerComponent> LayerKey,
+	                    const TMap<TWeakObjectPtr<UHierarchicalInstancedStaticMeshComponent>, TArray<FTransform>>&
+	                    Instances);
+
 	/**
 	 * Updates the vertex layer weights for the provided ground type layer
 	 */
 	static void UpdateVertexLayerWeights(FRuntimeLandscapeGroundTypeLayerSet& LayerSet);
 
+	void InitializeDimensions(const FIntPoint& InMeshResolution, int32 ComponentSizeQuads, float InQuadSideLength);
+	/** Destroys all components and their grass, returns the layers that affected them */
+	void RemoveLandscapeComponents(TSet<TObjectPtr<const ULandscapeLayerComponent>>& OutLandscapeLayers);
+	/** Rebuilds all components at once, in the editor it waits for them and shows the progress */
+	void StartInitialRebuild();
+	/** Sets the BaseHeightRange to cover the heights of all components that are created next */
+	void UpdateBaseHeightRange(const TArray<TArray<float>>& ComponentHeightValues);
+	/** Quantizes the heights of components saved before they were quantized, all with the same range */
+	void ConvertLegacyBaseHeights();
+	/** Creates a component at the specified location and starts rebuilding it */
+	URuntimeLandscapeComponent* CreateLandscapeComponent(const FVector& WorldLocation, int32 ComponentIndex,
+	                                                     const TArray<float>& HeightValues);
+	void GatherBakedContents(FRuntimeLandscapeBakedContents& OutContents) const;
+	/**
+	 * Restores the weights and missing components from the BakedData
+	 * @return true if the BakedData could be applied
+	 */
+	bool InitializeFromBakedData();
+
 	virtual void PostLoad() override;
 	virtual void BeginPlay() override;
 	void Rebuild();
@@ -326,3 +546,31 @@ public:
 
 #endif
 };
+
+/**
+ * Keeps an edit transaction open while it is in scope
+ * Use it to batch many layer changes into a single rebuild per component
+ */
+struct RUNTIMEEDITABLELANDSCAPE_API FRuntimeLandscapeEditScope
+{
+	explicit FRuntimeLandscapeEditScope(ARuntimeLandscape* InLandscape) : Landscape(InLandscape)
+	{
+		if (Landscape.IsValid())
+		{
+			Landscape->BeginEdit();
+		}
+	}
+
+	~FRuntimeLandscapeEditScope()
+	{
+		if (Landscape.IsValid())
+		{
+			Landscape->EndEdit();
+		}
+	}
+
+	UE_NONCOPYABLE(FRuntimeLandscapeEditScope);
+
+private:
+	TWeakObjectPtr<ARuntimeLandscape> Landscape;
+};
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/BulkData.h"
+#include "UObject/Object.h"
+#include "Threads/RuntimeLandscapeRebuildManager.h"
+#include "RuntimeLandscapeBakedData.generated.h"
+
+/**
+ * Heights of a single component, quantized to 16 bit
+ */
+struct FRuntimeLandscapeBakedComponent
+{
+	int32 Index = INDEX_NONE;
+	/** Location relative to the landscape */
+	FVector RelativeLocation = FVector::ZeroVector;
+	/** Heights without the height of the parent landscape */
+	FRuntimeLandscapeQuantizedHeights Heights;
+
+	friend FArchive& operator<<(FArchive& Ar, FRuntimeLandscapeBakedComponent& Component);
+};
+
+/**
+ * Weights of a single ground type layer set
+ */
+struct FRuntimeLandscapeBakedLayerSet
+{
+	/** The ground types mapped to the color channels, used to detect outdated data */
+	TArray<FSoftObjectPath> GroundTypes;
+	TArray<FColor> VertexLayerWeights;
+
+	friend FArchive& operator<<(FArchive& Ar, FRuntimeLandscapeBakedLayerSet& LayerSet);
+};
+
+/**
+ * Everything that is stored in the baked data
+ */
+struct FRuntimeLandscapeBakedContents
+{
+	FIntVector2 VertexAmountPerComponent = FIntVector2(0, 0);
+	TArray<FRuntimeLandscapeBakedComponent> Components;
+	TArray<FRuntimeLandscapeBakedLayerSet> LayerSets;
+
+	friend FArchive& operator<<(FArchive& Ar, FRuntimeLandscapeBakedContents& Contents);
+};
+
+UCLASS()
+/**
+ * Versioned binary cache of the baked heights and ground type weights of a runtime landscape
+ * Allows the landscape to start without the parent landscape and without rendering the weightmaps on the GPU
+ * The payload is stored as bulk data, so it is only loaded when the landscape is initialized
+ */
+class RUNTIMEEDITABLELANDSCAPE_API URuntimeLandscapeBakedData : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Increment when the binary layout changes, older data is ignored */
+	static constexpr int32 DataVersion = 1;
+
+	bool HasData() const { return BulkData.GetBulkDataSize() > 0; }
+
+	/** Replaces the stored data */
+	void Store(FRuntimeLandscapeBakedContents& Contents);
+	/**
+	 * Loads the stored data
+	 * @return false if there is no data or it was stored with an older version
+	 */
+	bool Load(FRuntimeLandscapeBakedContents& OutContents) const;
+	/** Frees the loaded payload, it won't be needed anymore once the landscape is initialized */
+	void UnloadPayload();
+
+	virtual void Serialize(FArchive& Ar) override;
+
+private:
+	FByteBulkData BulkData;
+};
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RuntimeLandscapeEditHandle.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "RuntimeLandscapeBlueprintLibrary.generated.h"
+
+class ULandscapeLayerComponent;
+
+UCLASS()
+/**
+ * Blueprint access to runtime landscape edits
+ */
+class RUNTIMEEDITABLELANDSCAPE_API URuntimeLandscapeBlueprintLibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintCallable, Category = "Runtime Landscape")
+	/**
+	 * Applies the layer to all affected landscapes
+	 * @return Handle that completes once the layer is visible on the landscapes
+	 */
+	static FRuntimeLandscapeEditHandle ApplyLandscapeLayer(ULandscapeLayerComponent* Layer);
+
+	UFUNCTION(BlueprintPure, Category = "Runtime Landscape")
+	/** Returns true if the edit is visible on all affected landscape components */
+	static bool IsLandscapeEditComplete(const FRuntimeLandscapeEditHandle& EditHandle);
+
+	UFUNCTION(BlueprintCallable, Category = "Runtime Landscape",
+		meta = (Latent, LatentInfo = "LatentInfo", WorldContext = "WorldContextObject"))
+	/** Waits until the edit is visible on all affected landscape components, including collision and grass */
+	static void WaitForLandscapeEdit(const UObject* WorldContextObject, const FRuntimeLandscapeEditHandle& EditHandle,
+	                                 FLatentActionInfo LatentInfo);
+};
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chaos/HeightField.h"
+#include "Components/PrimitiveComponent.h"
+#include "RuntimeLandscapeCollisionComponent.generated.h"
+
+/**
+ * Heightfield samples of a single component, generated by the rebuild threads
+ * Never modified after creation, so the next rebuild can compare against it without copying
+ */
+struct FRuntimeLandscapeCollisionData
+{
+	/** Chaos heightfields treat quads with this material index as holes */
+	static constexpr uint8 HoleMaterialIndex = TNumericLimits<uint8>::Max();
+
+	/** The heights of the samples relative to the component, row by row */
+	TArray<float> Heights;
+	/** One entry per quad, holes use the material index reserved for holes */
+	TArray<uint8> MaterialIndices;
+	FIntVector2 NumSamples = FIntVector2(0, 0);
+	/** The distance between the samples and the height scale, includes the scale of the component */
+	FVector SampleScale = FVector::OneVector;
+	FBox LocalBox = FBox(ForceInit);
+	/** The samples that changed compared to the previous data, inclusive */
+	FIntRect DirtyRect;
+	/** Only built if the previous heightfield can't be edited in place */
+	Chaos::FHeightFieldPtr HeightField;
+
+	/** Returns true if the heightfield of the other data can be edited to match this one */
+	bool IsEditableFrom(const FRuntimeLandscapeCollisionData& Other) const
+	{
+		return NumSamples == Other.NumSamples && SampleScale == Other.SampleScale &&
+			MaterialIndices == Other.MaterialIndices;
+	}
+
+	SIZE_T GetAllocatedSize() const { return Heights.GetAllocatedSize() + MaterialIndices.GetAllocatedSize(); }
+	/** Creates a new heightfield from the samples */
+	Chaos::FHeightFieldPtr BuildHeightField() const;
+};
+
+typedef TSharedPtr<const FRuntimeLandscapeCollisionData, ESPMode::ThreadSafe> FRuntimeLandscapeCollisionDataPtr;
+
+UCLASS()
+/**
+ * Collision of a runtime landscape component as a Chaos heightfield
+ * The heightfield is built directly from the rebuilt heights, so no triangle mesh has to be cooked
+ */
+class RUNTIMEEDITABLELANDSCAPE_API URuntimeLandscapeCollisionComponent : public UPrimitiveComponent
+{
+	GENERATED_BODY()
+
+public:
+	URuntimeLandscapeCollisionComponent();
+
+	/**
+	 * Uses the collision data, only the rectangle that changed is edited if the heightfield was not built already
+	 * @param PreviousData The data the new data was compared against by the rebuild threads
+	 */
+	void ApplyCollisionData(const FRuntimeLandscapeCollisionDataPtr& NewData,
+	                        const FRuntimeLandscapeCollisionDataPtr& PreviousData);
+	/** Removes the heightfield and its physics body */
+	void ClearHeightField();
+	bool HasHeightField() const { return HeightField.IsValid(); }
+	/** The data of the current heightfield, the next rebuild is compared against it */
+	const FRuntimeLandscapeCollisionDataPtr& GetCollisionData() const { return CollisionData; }
+	/** The CPU side memory of the heightfield and the cached samples */
+	SIZE_T GetHeightFieldSize() const;
+	/**
+	 * The area of the last applied change in world space, the navigation gathers the new geometry lazily from it
+	 * @return false if the component has to be updated in the navigation octree instead, i.e. because it grew
+	 */
+	bool GetNavigationDirtyArea(FBox& OutArea) const;
+	/** Remembers the bounds the component is registered with in the navigation octree */
+	void MarkNavigationBoundsRegistered() { RegisteredNavigationBounds = Bounds.GetBox(); }
+
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+	virtual bool DoCustomNavigableGeometryExport(FNavigableGeometryExport& GeomExport) const override;
+	virtual ENavDataGatheringMode GetGeometryGatheringMode() const override { return ENavDataGatheringMode::Lazy; }
+	virtual bool SupportsGatheringGeometrySlices() const override { return true; }
+	virtual void PrepareGeometryExportSync() override;
+	virtual void GatherGeometrySlice(FNavigableGeometryExport& GeomExport, const FBox& SliceBox) const override;
+
+protected:
+	virtual bool ShouldCreatePhysicsState() const override;
+	virtual void OnCreatePhysicsState() override;
+	virtual void OnDestroyPhysicsState() override;
+
+private:
+	Chaos::FHeightFieldPtr HeightField;
+	FRuntimeLandscapeCollisionDataPtr CollisionData;
+	/** The collision data the navigation gathers its geometry from, captured on the game thread */
+	FRuntimeLandscapeCollisionDataPtr NavigationCollisionData;
+	FBox RegisteredNavigationBounds = FBox(ForceInit);
+
+	/** Edits the heights of the current heightfield in place */
+	void EditHeightField(const FRuntimeLandscapeCollisionData& NewData);
+};
@@ -6,12 +6,18 @@
 #include "LandscapeGrassType.h"
 #include "LandscapeLayerActor.h"
 #include "ProceduralMeshComponent.h"
+#include "Threads/RuntimeLandscapeRebuildManager.h"
 #include "RuntimeLandscapeComponent.generated.h"
 
 
+struct FRuntimeLandscapeRebuildGeneration;
 struct FRuntimeLandscapeRebuildBuffer;
+struct FRuntimeLandscapeRebuildJob;
+struct FRuntimeLandscapeApplyState;
+struct FRuntimeLandscapeMemoryUsage;
+struct FRuntimeLandscapeLODBuild;
 struct FLandscapeVertexData;
-class UHierarchicalInstancedStaticMeshComponent;
+class URuntimeLandscapeCollisionComponent;
 class ARuntimeLandscape;
 class ULandscapeLayerComponent;
 
@@ -21,23 +27,13 @@ class RUNTIMEEDITABLELANDSCAPE_API URuntimeLandscapeComponent : public UProcedur
 	GENERATED_BODY()
 
 	friend class ARuntimeLandscape;
-	friend class FGenerateVerticesWorker;
 	friend class URuntimeLandscapeRebuildManager;
+	friend class URuntimeLandscapeRebuildSubsystem;
 
 public:
-	void AddLandscapeLayer(const ULandscapeLayerComponent* Layer);
+	URuntimeLandscapeComponent();
 
-	void SetHoleFlagForVertex(int32 VertexIndex, bool bValue)
-	{
-		if (bValue)
-		{
-			VerticesInHole.Add(VertexIndex);
-		}
-		else
-		{
-			VerticesInHole.Remove(VertexIndex);
-		}
-	}
+	void AddLandscapeLayer(const ULandscapeLayerComponent* Layer);
 
 	void RemoveLandscapeLayer(const ULandscapeLayerComponent* Layer)
 	{
@@ -46,6 +42,11 @@ public:
 	}
 
 	void Initialize(int32 ComponentIndex, const TArray<float>& HeightValuesInitial);
+	/**
+	 * Marks the component as dirty and requests a rebuild
+	 * Can be called from any thread, requests from other threads are picked up by the game thread on the next tick
+	 */
+	void RequestRebuild();
 
 	FORCEINLINE ARuntimeLandscape* GetParentLandscape() const { return ParentLandscape; }
 	FORCEINLINE const TSet<TObjectPtr<const ULandscapeLayerComponent>>& GetAffectingLayers() const
@@ -54,15 +55,78 @@ public:
 	}
 
 	FORCEINLINE int32 GetComponentIndex() const { return Index; }
+	/** Returns true if all changes up to the specified generation are visible on the component */
+	FORCEINLINE bool IsGenerationApplied(uint32 Generation) const { return AppliedGeneration >= Generation; }
+	/** The current generation, incremented every time the component is dirtied */
+	uint32 GetRebuildGeneration() const;
+	/** Returns true if the component was dirtied and the rebuild is not applied yet */
+	bool HasPendingRebuild() const { return !IsGenerationApplied(GetRebuildGeneration()); }
+
+	/** The heights of the component without any layers, restores them if the component is cold */
+	const FRuntimeLandscapeQuantizedHeightsPtr& GetBaseHeights();
+	/**
+	 * Copies the base heights without changing the component, cold components stay compressed
+	 * @return false if the component has no base heights
+	 */
+	bool CopyBaseHeights(FRuntimeLandscapeQuantizedHeights& OutHeights) const;
+	/** Returns true if the CPU side data of the component is compressed, since it was not edited for a while */
+	bool IsCold() const { return CompressedBaseHeights.IsValid(); }
+	/** The time the last rebuild was applied, in platform seconds */
+	double GetLastEditTime() const { return LastEditTime; }
+
+	/** Adds the CPU side memory used by the component */
+	void GetMemoryUsage(FRuntimeLandscapeMemoryUsage& OutUsage);
+	bool HasGrass() const;
+	/** Returns true if the grass was removed to stay within the memory budget */
+	bool IsGrassEvicted() const { return bIsGrassEvicted; }
+	/** The memory the grass used before it was evicted */
+	SIZE_T GetEvictedGrassSize() const { return EvictedGrassSize; }
+	/**
+	 * Removes the grass instances to free memory, they are restored by the next rebuild
+	 * @return The freed memory
+	 */
+	SIZE_T EvictGrass();
+
+	/** Returns false if the component is too far away from the players to keep its mesh and grass */
+	bool IsStreamedIn() const { return bIsStreamedIn; }
+	/** Generates the mesh and grass again, including all layers that were applied while streamed out */
+	void StreamIn();
+	/** Releases the mesh, collision and grass and compresses the base heights */
+	void StreamOut();
+
+	/** The LOD that is currently rendered, the collision always uses the full resolution */
+	int32 GetLOD() const { return CurrentLOD; }
+	/**
+	 * Switches to the LOD, its mesh is generated on the rebuild threads and swapped in by ApplyLODBuild
+	 * LOD 0 is switched immediately, the full resolution is only moved back into the rendered section
+	 * @return false if the LOD can not be switched right now, i.e. while another LOD is generated
+	 */
+	bool RequestLOD(int32 LOD);
+	/** Returns true while the mesh of a requested LOD is generated or waits to be swapped in */
+	bool HasLODBuild() const { return LODBuild.IsValid(); }
+	/**
+	 * Swaps the generated LOD mesh into the rendered section, only that section is uploaded again
+	 * @return true if the LOD was switched, false if it is still generated
+	 */
+	bool ApplyLODBuild();
 
 	FVector2D GetRelativeVertexLocation(int32 VertexIndex) const;
 	virtual void DestroyComponent(bool bPromoteChildren = false) override;
+	virtual void BeginDestroy() override;
+
+	virtual void Serialize(FArchive& Ar) override;
+
+	//~ Begin Interface_CollisionDataProvider Interface
+	virtual bool GetPhysicsTriMeshData(struct FTriMeshCollisionData* CollisionData, bool InUseAllTriData) override;
+	virtual bool ContainsPhysicsTriMeshData(bool InUseAllTriData) const override;
+	//~ End Interface_CollisionDataProvider Interface
 
 protected:
 	UPROPERTY()
+	/** Heights saved before they were quantized, only kept to convert old data in ARuntimeLandscape::PostLoad */
 	TArray<float> InitialHeightValues = TArray<float>();
 	UPROPERTY()
-	/** All vertices that are inside at least one hole */
+	/** All vertices that are inside at least one hole, updated when a rebuild is applied */
 	TSet<int32> VerticesInHole = TSet<int32>();
 	UPROPERTY()
 	TSet<TObjectPtr<const ULandscapeLayerComponent>> AffectingLayers =
@@ -72,16 +136,63 @@ protected:
 	UPROPERTY()
 	int32 Index;
 	UPROPERTY()
-	TArray<UHierarchicalInstancedStaticMeshComponent*> GrassMeshes;
+	/** Provides the collision if the landscape uses heightfield collision */
+	TObjectPtr<URuntimeLandscapeCollisionComponent> CollisionComponent;
+
+	/**
+	 * The heights of the component without any layers, quantized to 16 bit
+	 * Never modified after creation, so it is shared with the rebuild threads instead of copied
+	 */
+	FRuntimeLandscapeQuantizedHeightsPtr BaseHeights;
+	/** The base heights while the component is cold */
+	FRuntimeLandscapeCompressedHeights CompressedBaseHeights;
+	double LastEditTime = 0.0;
+	bool bIsStreamedIn = true;
+	int32 CurrentLOD = 0;
+	/**
+	 * The full resolution mesh while a lower LOD is shown, only kept on the CPU to generate the LODs and the collision
+	 * Empty while LOD 0 is shown, the full resolution is at the start of the rendered section then
+	 * Followed by the skirts of LOD 0 in both cases, so switching back to LOD 0 only moves the arrays
+	 */
+	TArray<FProcMeshVertex> FullResolutionVertices;
+	TArray<uint32> FullResolutionIndices;
+	int32 NumFullResolutionVertices = 0;
+	int32 NumFullResolutionIndices = 0;
+	/** The LOD mesh generated on the rebuild threads, reads the full resolution and the holes until it is done */
+	TSharedPtr<FRuntimeLandscapeLODBuild, ESPMode::ThreadSafe> LODBuild;
+	bool bIsGrassEvicted = false;
+	SIZE_T EvictedGrassSize = 0;
+	/** Incremented every time the component is dirtied, shared with the rebuild threads to detect outdated work */
+	TSharedPtr<FRuntimeLandscapeRebuildGeneration, ESPMode::ThreadSafe> RebuildGeneration;
+	/** The generation of the last rebuild that was applied */
+	uint32 AppliedGeneration = 0;
 
-	TArray<float> HeightValues = TArray<float>();
-
-	UHierarchicalInstancedStaticMeshComponent* FindOrAddGrassMesh(const FGrassVariety& Variety);
 	void Rebuild();
-	void ApplyDataFromLayers(TArray<float>& OutHeightValues, TArray<FColor>& OutVertexColors);
-	void UpdateNavigation();
-	void RemoveFoliageAffectedByLayer() const;
-
-	/** Applies data to the landscape after all threads are finished */
-	void FinishRebuild(const FRuntimeLandscapeRebuildBuffer& RebuildBuffer);
+	/**
+	 * Queues the navigation update with the next navigation batch of the rebuild subsystem
+	 * @param Job The applied rebuild, limits the update to the area that changed. Updates the whole component if nullptr
+	 */
+	void UpdateNavigation(const FRuntimeLandscapeRebuildJob* Job = nullptr);
+	/**
+	 * Compresses the base heights, they are restored once the component is rebuilt again
+	 * @return true if the component is cold now
+	 */
+	bool CompressBaseHeights();
+
+	/**
+	 * Applies the data of a finished rebuild to the landscape, one step at a time
+	 * @return true if all steps are applied
+	 */
+	bool ApplyRebuildStep(FRuntimeLandscapeRebuildJob& Job, FRuntimeLandscapeApplyState& ApplyState);
+	/** Swaps the section generated by the rebuild threads into the mesh, the job receives the previous section */
+	void ApplyMesh(FRuntimeLandscapeRebuildJob& Job);
+	/** Applies the heightfield collision generated by the rebuild threads, creates the collision component if needed */
+	void ApplyHeightFieldCollision(const FRuntimeLandscapeRebuildJob& Job);
+	/**
+	 * Drops the LOD build, has to be called before the full resolution or the holes are changed
+	 * Waits for the rebuild thread if it already generates the mesh
+	 */
+	void CancelLODBuild();
+	/** Groups the generated grass instances by mesh */
+	void GatherGrass(FRuntimeLandscapeRebuildBuffer& RebuildBuffer, FRuntimeLandscapeApplyState& ApplyState);
 };
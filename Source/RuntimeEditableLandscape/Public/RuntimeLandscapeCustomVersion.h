@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Custom serialization version for data of the runtime landscape that is not stored as tagged properties
+ */
+struct RUNTIMEEDITABLELANDSCAPE_API FRuntimeLandscapeCustomVersion
+{
+	enum Type
+	{
+		BeforeCustomVersionWasAdded = 0,
+		/** Base heights of the components are stored as quantized uint16 instead of float */
+		QuantizedBaseHeights,
+		/** Cold components store their compressed base heights, instead of restoring them to save */
+		CompressedBaseHeights,
+
+		// -----<new versions can be added above this line>-------------------------------------------------
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	const static FGuid GUID;
+
+private:
+	FRuntimeLandscapeCustomVersion() = default;
+};
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RuntimeLandscapeEditHandle.generated.h"
+
+class ARuntimeLandscape;
+class URuntimeLandscapeComponent;
+
+USTRUCT(BlueprintType)
+/**
+ * Tracks an edit of one or more runtime landscapes
+ * The edit is complete once the rebuilds of all affected components are applied
+ */
+struct RUNTIMEEDITABLELANDSCAPE_API FRuntimeLandscapeEditHandle
+{
+	GENERATED_BODY()
+
+	/** Waits for the current generation of the component to be applied */
+	void AddComponent(const URuntimeLandscapeComponent* Component);
+	/** Waits for the landscape to be initialized and all of its components to be rebuilt */
+	void AddPendingLandscape(const ARuntimeLandscape* Landscape);
+	void Append(const FRuntimeLandscapeEditHandle& Other);
+
+	/** Returns true if the edit is visible on all affected components. Destroyed components count as complete */
+	bool IsComplete() const;
+
+private:
+	struct FComponentTicket
+	{
+		TWeakObjectPtr<const URuntimeLandscapeComponent> Component;
+		uint32 Generation = 0;
+	};
+
+	TArray<FComponentTicket> Tickets;
+	/** Landscapes that are not initialized yet, the edit is applied to them once they are */
+	TArray<TWeakObjectPtr<const ARuntimeLandscape>> PendingLandscapes;
+};
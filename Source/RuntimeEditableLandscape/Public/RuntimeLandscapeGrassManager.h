@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "RuntimeLandscapeGrassManager.generated.h"
+
+struct FGrassVariety;
+class UHierarchicalInstancedStaticMeshComponent;
+class URuntimeLandscapeComponent;
+class UStaticMesh;
+
+/**
+ * The instances a single component contributes to a grass mesh of a cell
+ */
+struct FRuntimeLandscapeGrassRange
+{
+	int32 Start = 0;
+	/** The instances that are used */
+	int32 Num = 0;
+	/** The instances reserved for the component, the unused ones are hidden with a zero scale */
+	int32 Capacity = 0;
+};
+
+USTRUCT()
+/**
+ * The instanced mesh of a single grass mesh in a cell
+ */
+struct FRuntimeLandscapeGrassCellMesh
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<UHierarchicalInstancedStaticMeshComponent> InstancedMesh;
+
+	/** The instances of each component by component index, stored contiguously in the instanced mesh */
+	TMap<int32, FRuntimeLandscapeGrassRange> ComponentRanges;
+	/** Hidden instances that don't belong to any component anymore, removed once they are half of the mesh */
+	int32 NumFreeInstances = 0;
+};
+
+USTRUCT()
+/**
+ * The grass of all components whose center is inside the cell
+ */
+struct FRuntimeLandscapeGrassCell
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TMap<TObjectPtr<const UStaticMesh>, FRuntimeLandscapeGrassCellMesh> Meshes;
+};
+
+UCLASS(Hidden)
+/**
+ * Owns the grass of a single landscape
+ * The grass is grouped into cells of a configurable size with a single instanced mesh per grass mesh,
+ * so the amount of draw calls and cluster trees doesn't depend on the amount of components
+ */
+class RUNTIMEEDITABLELANDSCAPE_API URuntimeLandscapeGrassManager : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Replaces the instances of a grass mesh of the component
+	 * The components reserve spare instances, so only their own range is updated as long as the instances fit
+	 * @param InstanceTransforms Relative to the component
+	 */
+	void SetComponentGrass(const URuntimeLandscapeComponent* Component, const FGrassVariety& Variety,
+	                       const TArray<FTransform>& InstanceTransforms);
+	/**
+	 * Removes the grass of the component
+	 * @param MeshesToKeep The grass meshes that are not removed, all are removed if nullptr
+	 * @return The estimated memory of the removed instances
+	 */
+	SIZE_T RemoveComponentGrass(const URuntimeLandscapeComponent* Component,
+	                            const TSet<const UStaticMesh*>* MeshesToKeep = nullptr);
+
+	bool HasGrass(const URuntimeLandscapeComponent* Component) const;
+	/** The memory of all grass instances */
+	SIZE_T GetGrassSize() const;
+
+private:
+	UPROPERTY(Transient)
+	TMap<FIntPoint, FRuntimeLandscapeGrassCell> Cells;
+	/** The cell the grass of each component is stored in, by component index */
+	TMap<int32, FIntPoint> ComponentCells;
+
+	FIntPoint GetCellCoordinates(const URuntimeLandscapeComponent* Component) const;
+	FRuntimeLandscapeGrassCellMesh& FindOrAddCellMesh(FRuntimeLandscapeGrassCell& Cell, const FGrassVariety& Variety);
+	/** The instances reserved for a component, a quarter more than it needs so small changes fit in place */
+	static int32 GetRangeCapacity(int32 NumInstances) { return NumInstances + NumInstances / 4; }
+	/** Appends hidden instances to the mesh */
+	static void AddHiddenInstances(FRuntimeLandscapeGrassCellMesh& CellMesh, int32 NumInstances,
+	                               const FTransform& HiddenTransform);
+	/** Hides the instances of the component and removes its range, the instances are reused by the compaction */
+	static void FreeComponentInstances(FRuntimeLandscapeGrassCellMesh& CellMesh, int32 ComponentIndex);
+	/** Removes the free instances once they make up half of the mesh, the ranges of all components move */
+	static void CompactInstances(FRuntimeLandscapeGrassCellMesh& CellMesh);
+	/** The estimated memory of the instances of the component in the mesh */
+	static SIZE_T GetComponentGrassSize(const FRuntimeLandscapeGrassCellMesh& CellMesh, int32 ComponentIndex);
+};
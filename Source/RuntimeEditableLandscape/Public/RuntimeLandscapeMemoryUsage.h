@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * CPU side memory used by runtime landscapes in bytes, split up by the kind of data
+ */
+struct RUNTIMEEDITABLELANDSCAPE_API FRuntimeLandscapeMemoryUsage
+{
+	/** The quantized or compressed heights of the components without layers */
+	SIZE_T BaseHeights = 0;
+	SIZE_T Holes = 0;
+	/** The vertex and index data of the procedural mesh sections */
+	SIZE_T MeshSections = 0;
+	/** The heightfield collision */
+	SIZE_T Collision = 0;
+	/** The instance data of the grass meshes */
+	SIZE_T Grass = 0;
+	/** The ground type weights of all vertices */
+	SIZE_T LayerWeights = 0;
+	/** The buffers of rebuilds that are in flight or kept for reuse */
+	SIZE_T RebuildBuffers = 0;
+
+	SIZE_T GetTotal() const
+	{
+		return BaseHeights + Holes + MeshSections + Collision + Grass + LayerWeights + RebuildBuffers;
+	}
+
+	FRuntimeLandscapeMemoryUsage& operator+=(const FRuntimeLandscapeMemoryUsage& Other);
+	FString ToString() const;
+};
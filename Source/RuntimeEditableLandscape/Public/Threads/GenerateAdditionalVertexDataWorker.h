@@ -7,44 +7,49 @@
 
 struct FGrassVariety;
 class ULandscapeGrassType;
-class URuntimeLandscapeRebuildManager;
 /**
- * Runner that generates additional vertex info
+ * Runner that generates additional vertex info for a single vertex row
  * run when all vertices are generated in the RLRS_BuildAdditionalData stage
+ * Deletes itself when the work is done
  */
 class RUNTIMEEDITABLELANDSCAPE_API FGenerateAdditionalVertexDataWorker : public IQueuedWork
 {
-	friend class URuntimeLandscapeRebuildManager;
-
 public:
-	FGenerateAdditionalVertexDataWorker(URuntimeLandscapeRebuildManager* RebuildManager);
-	~FGenerateAdditionalVertexDataWorker();
+	FGenerateAdditionalVertexDataWorker(const FRuntimeLandscapeRebuildJobPtr& InJob, int32 Y);
 
-private:
-	int32 YCoordinate = 0;
-	int32 StartIndex = 0;
-	FVector2D UV1Offset = FVector2D();
-	TObjectPtr<URuntimeLandscapeRebuildManager> RebuildManager;
-
-	void GenerateGrassDataForVertex(const int32 VertexIndex, int32 X);
-	void GenerateGrassTransformsAtVertex(const FGrassTypeSettings& SelectedGrass, const int32 VertexIndex,
-	                                        float Weight) const;
-	void GetRandomGrassRotation(const FGrassVariety& Variety, FRotator& OutRotation) const;
-	void GetRandomGrassLocation(const FVector& VertexRelativeLocation, FVector& OutGrassLocation) const;
-	void GetRandomGrassScale(const FGrassVariety& Variety, FVector& OutScale) const;
-
-	void QueueWork(int32 Y, int32 VertexStartIndex, const FVector2D& InUV1Offset)
+	/** Generates the additional data for a single vertex row of the job */
+	static void GenerateAdditionalDataForRow(FRuntimeLandscapeRebuildJob& Job, int32 Y);
+
+	/** Queues a runner for every vertex row, the job has to account for the runners in ActiveRunners */
+	static void QueueWork(const FRuntimeLandscapeRebuildJobPtr& Job, FQueuedThreadPool* ThreadPool)
 	{
-		YCoordinate = Y;
-		StartIndex = VertexStartIndex;
-		UV1Offset = InUV1Offset;
-		RebuildManager->ThreadPool->AddQueuedWork(this);
+		for (int32 Y = 0; Y < Job->ComponentResolution.Y + 1; Y++)
+		{
+			ThreadPool->AddQueuedWork(new FGenerateAdditionalVertexDataWorker(Job, Y));
+		}
 	}
 
+private:
+	int32 YCoordinate = 0;
+	FRuntimeLandscapeRebuildJobPtr Job;
+
+	static void GenerateGrassDataForVertex(FRuntimeLandscapeRebuildJob& Job, const int32 VertexIndex, int32 X,
+	                                       int32 Y);
+	static void GenerateGrassTransformsAtVertex(FRuntimeLandscapeRebuildJob& Job,
+	                                            const FRuntimeLandscapeGrassRule& SelectedGrass,
+	                                            const int32 VertexIndex, float Weight);
+	static void GetRandomGrassRotation(const FGrassVariety& Variety, FRotator& OutRotation);
+	static void GetRandomGrassLocation(const FRuntimeLandscapeRebuildJob& Job, const FVector& VertexRelativeLocation,
+	                                   FVector& OutGrassLocation);
+	static void GetRandomGrassScale(const FGrassVariety& Variety, FVector& OutScale);
+
 	virtual void DoThreadedWork() override;
 
 	virtual void Abandon() override
 	{
-		RebuildManager->CancelRebuild();
+		// the thread pool is shut down, make sure the incomplete results are never applied
+		Job->GenerationCounter->Increment();
+		Job->NotifyRunnerFinished();
+		delete this;
 	}
 };
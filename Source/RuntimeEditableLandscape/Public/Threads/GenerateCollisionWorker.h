@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RuntimeLandscapeRebuildManager.h"
+
+/**
+ * Runner that generates the heightfield collision of a single component
+ * run next to the additional data runners in the RLRS_BuildAdditionalData stage
+ * Deletes itself when the work is done
+ */
+class RUNTIMEEDITABLELANDSCAPE_API FGenerateCollisionWorker : public IQueuedWork
+{
+public:
+	explicit FGenerateCollisionWorker(const FRuntimeLandscapeRebuildJobPtr& InJob);
+
+	/**
+	 * Samples the heightfield from the vertices and compares it with the previous collision of the component
+	 * Leaves the collision of the job empty if nothing changed
+	 */
+	static void GenerateCollision(FRuntimeLandscapeRebuildJob& Job);
+
+	/** Queues collision generation for the job, the job has to account for the runner in ActiveRunners */
+	static void QueueWork(const FRuntimeLandscapeRebuildJobPtr& Job, FQueuedThreadPool* ThreadPool)
+	{
+		ThreadPool->AddQueuedWork(new FGenerateCollisionWorker(Job));
+	}
+
+private:
+	FRuntimeLandscapeRebuildJobPtr Job;
+
+	virtual void DoThreadedWork() override;
+
+	virtual void Abandon() override
+	{
+		// the thread pool is shut down, make sure the incomplete results are never applied
+		Job->GenerationCounter->Increment();
+		Job->NotifyRunnerFinished();
+		delete this;
+	}
+};
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProceduralMeshComponent.h"
+#include "HAL/Event.h"
+
+enum ERuntimeLandscapeLODBuildState : uint8
+{
+	RLLS_Queued,
+	RLLS_Running,
+	RLLS_Done,
+	RLLS_Cancelled
+};
+
+/**
+ * Generates the mesh of a single LOD of a component on the rebuild threads
+ * The full resolution and the holes are only referenced, the component keeps them unchanged until the build is done
+ * or cancels it first, see URuntimeLandscapeComponent::CancelLODBuild
+ */
+struct FRuntimeLandscapeLODBuild
+{
+	// Input data
+	/** The full resolution vertices of the component, followed by the skirts of LOD 0 */
+	const TArray<FProcMeshVertex>* FullResolutionVertices = nullptr;
+	const TSet<int32>* VerticesInHole = nullptr;
+	FIntVector2 VertexAmount;
+	int32 LOD = 0;
+	float SkirtDepth = 0.0f;
+
+	// Output data
+	TArray<FProcMeshVertex> Vertices;
+	TArray<uint32> Indices;
+
+	std::atomic<ERuntimeLandscapeLODBuildState> State = RLLS_Queued;
+	/** Triggered once the worker does not access the input data anymore */
+	FEventRef FinishedEvent = FEventRef(EEventMode::ManualReset);
+};
+
+typedef TSharedPtr<FRuntimeLandscapeLODBuild, ESPMode::ThreadSafe> FRuntimeLandscapeLODBuildPtr;
+
+/**
+ * Runner that generates the mesh of a LOD, so the game thread only has to swap it into the section
+ * Deletes itself when the work is done
+ */
+class RUNTIMEEDITABLELANDSCAPE_API FGenerateLODWorker : public IQueuedWork
+{
+public:
+	explicit FGenerateLODWorker(const FRuntimeLandscapeLODBuildPtr& InBuild);
+
+	/**
+	 * Generates the mesh of a LOD above 0 from the full resolution, including the skirts. Thread safe
+	 * Quads that contain a vertex in a hole are left out
+	 */
+	static void GenerateLODMesh(const TArray<FProcMeshVertex>& FullResolutionVertices, const FIntVector2& VertexAmount,
+	                            const TSet<int32>& VerticesInHole, int32 LOD, float SkirtDepth,
+	                            TArray<FProcMeshVertex>& OutVertices, TArray<uint32>& OutIndices);
+	/**
+	 * Appends the skirts of the LOD, they reach below the borders and hide the cracks between different LODs
+	 * The output can be the full resolution itself, LOD 0 only adds the skirts behind it
+	 */
+	static void AppendSkirts(const TArray<FProcMeshVertex>& FullResolutionVertices, const FIntVector2& VertexAmount,
+	                         const TSet<int32>& VerticesInHole, int32 LOD, float SkirtDepth,
+	                         TArray<FProcMeshVertex>& OutVertices, TArray<uint32>& OutIndices);
+
+	static void QueueWork(const FRuntimeLandscapeLODBuildPtr& Build, FQueuedThreadPool* ThreadPool)
+	{
+		ThreadPool->AddQueuedWork(new FGenerateLODWorker(Build));
+	}
+
+private:
+	FRuntimeLandscapeLODBuildPtr Build;
+
+	/** Every n-th coordinate of the LOD, always including the last one so the borders match the neighbours */
+	static TArray<int32> SampleCoordinates(int32 Amount, int32 LOD);
+
+	virtual void DoThreadedWork() override;
+
+	virtual void Abandon() override
+	{
+		// the thread pool is shut down, the build is never applied
+		Build->State = RLLS_Cancelled;
+		Build->FinishedEvent->Trigger();
+		delete this;
+	}
+};
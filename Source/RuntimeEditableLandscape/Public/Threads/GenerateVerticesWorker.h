@@ -7,7 +7,8 @@
 #include "UObject/Object.h"
 
 /**
- * Thread that is used to create data for a single vertex row
+ * Thread that is used to create the vertex data of a single component
+ * Deletes itself when the work is done
 */
 
 class URuntimeLandscapeComponent;
@@ -16,26 +17,42 @@ struct FGrassVariety;
 
 class FGenerateVerticesWorker : public IQueuedWork
 {
-	friend class URuntimeLandscapeRebuildManager;
-
 public:
-	FGenerateVerticesWorker(URuntimeLandscapeRebuildManager* RebuildManager);
-	virtual ~FGenerateVerticesWorker() override;
+	FGenerateVerticesWorker(const FRuntimeLandscapeRebuildJobPtr& InJob, FQueuedThreadPool* InThreadPool);
 
-private:
-	TObjectPtr<URuntimeLandscapeRebuildManager> RebuildManager;
-	FVector2D UV1Offset;
+	/** Generates the vertices of the job, returns early if the job becomes stale */
+	static void GenerateVertices(FRuntimeLandscapeRebuildJob& Job);
 
-	void QueueWork(FVector2D InUV1Offset)
+	/**
+	 * Queues vertex generation for the job, the job has to account for the runner in ActiveRunners
+	 * Batch jobs queue their additional data stage to the same thread pool once the vertices are done
+	 */
+	static void QueueWork(const FRuntimeLandscapeRebuildJobPtr& Job, FQueuedThreadPool* ThreadPool)
 	{
-		UV1Offset = InUV1Offset;
-		RebuildManager->ThreadPool->AddQueuedWork(this);
+		ThreadPool->AddQueuedWork(new FGenerateVerticesWorker(Job, ThreadPool));
 	}
 
+private:
+	FRuntimeLandscapeRebuildJobPtr Job;
+	FQueuedThreadPool* ThreadPool = nullptr;
+
+	/** Applies the captured layers to the base heights and collects the holes */
+	static void ApplyLayers(FRuntimeLandscapeRebuildJob& Job);
+	/** Calculates the normals and tangents from the regular grid of the vertices, the UVs follow the same grid */
+	static void CalculateGridTangents(FRuntimeLandscapeRebuildJob& Job);
+	/**
+	 * Converts the generated data to the layout of the procedural mesh section, so it only has to be swapped in
+	 * Also generates the skirts and the mesh of the LOD the component shows
+	 */
+	static void FillSection(FRuntimeLandscapeRebuildJob& Job);
+
 	virtual void DoThreadedWork() override;
 
 	virtual void Abandon() override
 	{
-		RebuildManager->CancelRebuild();
+		// the thread pool is shut down, make sure the incomplete results are never applied
+		Job->GenerationCounter->Increment();
+		Job->NotifyRunnerFinished();
+		delete this;
 	}
 };
@@ -4,14 +4,15 @@
 
 #include "CoreMinimal.h"
 #include "LandscapeGrassType.h"
+#include "LandscapeLayerComponent.h"
 #include "RuntimeLandscape.h"
 #include "Components/ActorComponent.h"
+#include "HAL/Event.h"
 #include "RuntimeLandscapeRebuildManager.generated.h"
 
 
 struct FProcMeshTangent;
-class FGenerateAdditionalVertexDataWorker;
-class FGenerateVerticesWorker;
+struct FRuntimeLandscapeCollisionData;
 class ARuntimeLandscape;
 class URuntimeLandscapeComponent;
 
@@ -22,6 +23,89 @@ enum ERuntimeLandscapeRebuildState : uint8
 	RLRS_BuildAdditionalData
 };
 
+/**
+ * Generation counter of a single landscape component
+ * Incremented every time the component is dirtied, so rebuilds that are in flight can detect that they are outdated
+ */
+struct FRuntimeLandscapeRebuildGeneration
+{
+	uint32 Increment() { return ++Value; }
+	uint32 Get() const { return Value.load(); }
+
+	/** Returns true if the component was not requested yet, used to queue requests from other threads only once */
+	bool TryMarkRequested() { return !bIsRequested.exchange(true); }
+	void ClearRequested() { bIsRequested = false; }
+
+private:
+	std::atomic<uint32> Value = 0;
+	std::atomic<bool> bIsRequested = false;
+};
+
+/**
+ * Quantized heights of a component that is not edited for a while, delta and entropy coded
+ */
+struct RUNTIMEEDITABLELANDSCAPE_API FRuntimeLandscapeCompressedHeights
+{
+	float Offset = 0.0f;
+	float Scale = 0.0f;
+	int32 NumSamples = 0;
+	TArray<uint8> Data;
+
+	bool IsValid() const { return NumSamples > 0; }
+	void Reset() { *this = FRuntimeLandscapeCompressedHeights(); }
+
+	friend FArchive& operator<<(FArchive& Ar, FRuntimeLandscapeCompressedHeights& Heights)
+	{
+		Ar << Heights.Offset;
+		Ar << Heights.Scale;
+		Ar << Heights.NumSamples;
+		Heights.Data.BulkSerialize(Ar);
+		return Ar;
+	}
+};
+
+/**
+ * Heights quantized to 16 bit, restored with a shared offset and scale
+ * Never modified after creation, so it can be shared with the rebuild threads without copying
+ */
+struct RUNTIMEEDITABLELANDSCAPE_API FRuntimeLandscapeQuantizedHeights
+{
+	TArray<uint16> Samples;
+	float Offset = 0.0f;
+	float Scale = 0.0f;
+
+	/**
+	 * Quantizes the heights, the offset and scale are chosen to cover the range
+	 * Heights that are quantized with the same range always restore the same value, i.e. the borders of neighbours
+	 * @param HeightValues		The heights to store, values outside of the range are clamped
+	 * @param Range				The range of the heights, shared by all components of a landscape
+	 * @param AdditionalOffset	Added to all heights, without costing precision
+	 */
+	void Quantize(const TArray<float>& HeightValues, const FFloatInterval& Range, float AdditionalOffset = 0.0f);
+	void Dequantize(TArray<float>& OutHeightValues) const;
+
+	/**
+	 * Stores the difference to the previous sample and compresses the result
+	 * @return false if the heights could not be compressed
+	 */
+	bool Compress(FRuntimeLandscapeCompressedHeights& OutCompressed) const;
+	/** Restores heights that were stored with Compress */
+	bool Decompress(const FRuntimeLandscapeCompressedHeights& Compressed);
+
+	FORCEINLINE float Get(int32 Index) const { return Offset + Samples[Index] * Scale; }
+	FORCEINLINE int32 Num() const { return Samples.Num(); }
+
+	friend FArchive& operator<<(FArchive& Ar, FRuntimeLandscapeQuantizedHeights& Heights)
+	{
+		Ar << Heights.Offset;
+		Ar << Heights.Scale;
+		Heights.Samples.BulkSerialize(Ar);
+		return Ar;
+	}
+};
+
+typedef TSharedPtr<FRuntimeLandscapeQuantizedHeights, ESPMode::ThreadSafe> FRuntimeLandscapeQuantizedHeightsPtr;
+
 struct FLandscapeGrassVertexData
 {
 	FGrassVariety GrassVariety;
@@ -38,6 +122,70 @@ struct FLandscapeAdditionalData
 	}
 };
 
+/**
+ * Plain data copy of grass settings, so the rebuild threads never have to access the grass type asset
+ */
+struct FRuntimeLandscapeGrassRule
+{
+	FRuntimeLandscapeGrassRule() = default;
+	explicit FRuntimeLandscapeGrassRule(const FGrassTypeSettings& Settings);
+
+	TArray<FGrassVariety> Varieties;
+	float MaxSlopeAngle = 0.0f;
+};
+
+/**
+ * Plain data copy of height based grass settings
+ */
+struct FRuntimeLandscapeHeightGrassRule
+{
+	float MinHeight = FLT_MIN;
+	float MaxHeight = FLT_MAX;
+	FRuntimeLandscapeGrassRule Grass;
+};
+
+/**
+ * Snapshot of a single ground type layer set, restricted to the vertices of one component
+ */
+struct FRuntimeLandscapeGroundTypeWeights
+{
+	/** Whether there is a ground type mapped to the color channel */
+	TStaticArray<bool, 4> HasGroundType = TStaticArray<bool, 4>(InPlace, false);
+	/** The grass of the ground type mapped to the color channel */
+	TStaticArray<FRuntimeLandscapeGrassRule, 4> Grass;
+	/**
+	 * The layer weights of every vertex in the component
+	 * each layer is stored in a separate color channel
+	 */
+	TArray<FColor> VertexWeights;
+
+	static float GetChannelWeight(const FColor& Color, int32 Channel)
+	{
+		switch (Channel)
+		{
+		case 0:
+			return Color.R / 255.0f;
+		case 1:
+			return Color.G / 255.0f;
+		case 2:
+			return Color.B / 255.0f;
+		case 3:
+			return Color.A / 255.0f;
+		default:
+			checkNoEntry();
+		}
+
+		return 0.0f;
+	}
+};
+
+/**
+ * The components never have more than 256x256 vertices, so 16 bit indices are enough on the CPU side
+ * The procedural mesh only takes 32 bit indices, the sections still get a widened copy per component
+ */
+typedef TArray<uint16> FRuntimeLandscapeIndexArray;
+typedef TSharedPtr<const FRuntimeLandscapeIndexArray, ESPMode::ThreadSafe> FRuntimeLandscapeSharedIndicesPtr;
+
 USTRUCT()
 /**
  * Stores data required to rebuild a single runtime landscape component
@@ -47,30 +195,48 @@ struct FRuntimeLandscapeRebuildBuffer
 	GENERATED_BODY()
 
 	// InputData
+	/** The heights with all layers applied, empty if the component has no layers and the base heights are used */
 	TArray<float> HeightValues;
 
 	// Vertices
 	TArray<FVector> VerticesRelative;
-	TArray<int32> Triangles;
+	/** The triangles with flat areas merged, empty if the adaptive triangulation is disabled */
+	FRuntimeLandscapeIndexArray AdaptiveTriangles;
 
-	// UV
-	TArray<FVector2D> UV0Coords;
-	TArray<FVector2D> UV1Coords;
+	// UV, calculated from the grid position while the section is filled
 	FVector2D UV1Offset;
 
 	// Tangents
 	TArray<FVector> Normals;
 	TArray<FProcMeshTangent> Tangents;
 
+	// Section
+	/**
+	 * The vertices and triangles in the layout of the procedural mesh, filled by the rebuild threads
+	 * The full resolution is followed by the skirts of LOD 0, so it can be rendered as is
+	 * Swapped with the arrays of the section when applied, so the previous section is reused by the next rebuild
+	 */
+	TArray<FProcMeshVertex> SectionVertices;
+	TArray<uint32> SectionIndices;
+	/** The indices of the full resolution, without the skirts */
+	int32 NumFullResolutionIndices = 0;
+	FBox SectionLocalBox = FBox(ForceInit);
+	/** The mesh of the LOD of the job, only generated if it is not LOD 0 */
+	TArray<FProcMeshVertex> LODVertices;
+	TArray<uint32> LODIndices;
+
 	// Additional data
 	TArray<FLandscapeAdditionalData> AdditionalData;
 
 	ERuntimeLandscapeRebuildState RebuildState = ERuntimeLandscapeRebuildState::RLRS_None;
+
+	bool IsInitialized() const { return !VerticesRelative.IsEmpty(); }
+	SIZE_T GetAllocatedSize() const;
 };
 
 USTRUCT()
 /**
- * Caches information required to rebuild the components 
+ * Caches information required to rebuild the components
  */
 struct FGenerationDataCache
 {
@@ -81,94 +247,189 @@ struct FGenerationDataCache
 	float UVIncrement;
 };
 
+/**
+ * Progress of the batch rebuilds, shared with the rebuild threads
+ */
+struct FRuntimeLandscapeBatchProgress
+{
+	/** Only modified by the game thread */
+	int32 TotalComponents = 0;
+	/** Components that are done on the rebuild threads */
+	std::atomic<int32> FinishedComponents = 0;
+	/** Triggered every time a component is done, so the game thread can wait for the batch without polling */
+	FEventRef ComponentFinishedEvent;
+
+	void NotifyComponentFinished()
+	{
+		++FinishedComponents;
+		ComponentFinishedEvent->Trigger();
+	}
+};
+
+/**
+ * Everything that is required to rebuild a single component
+ * The input data is captured on the game thread when the rebuild is started and never modified afterwards,
+ * so the rebuild threads never have to access live UObjects while gameplay keeps editing the landscape
+ */
+struct FRuntimeLandscapeRebuildJob
+{
+	// Input data
+	int32 ComponentIndex = INDEX_NONE;
+	/** The generation of the component the job was created for */
+	uint32 Generation = 0;
+	TSharedPtr<FRuntimeLandscapeRebuildGeneration, ESPMode::ThreadSafe> GenerationCounter;
+	FIntVector2 ComponentResolution;
+	FVector ComponentLocation;
+	float ParentHeight = 0.0f;
+	float AreaPerSquare = 0.0f;
+	FGenerationDataCache GenerationData;
+	/** The triangles of a component without holes, the same for all components of the landscape */
+	FRuntimeLandscapeSharedIndicesPtr SharedTriangles;
+	TArray<FRuntimeLandscapeGroundTypeWeights> GroundTypeWeights;
+	TArray<FRuntimeLandscapeHeightGrassRule> HeightBasedGrass;
+	/** The heights of the component without any layers */
+	FRuntimeLandscapeQuantizedHeightsPtr BaseHeights;
+	/** The layers that affect the component in the order they are applied, applied by the vertex worker */
+	TArray<FLandscapeLayerSnapshot> Layers;
+	/** The LOD the component shows once the job is applied, its mesh is generated together with the full resolution */
+	int32 LOD = 0;
+	/** How far the skirts of the LODs reach below the borders */
+	float SkirtDepth = 0.0f;
+	/** The maximum height error of merged quads, 0 disables the adaptive triangulation */
+	float AdaptiveTolerance = 0.0f;
+	/** Whether the heightfield collision is generated by the rebuild threads */
+	bool bBuildCollision = false;
+	/** Every n-th vertex is used as a collision sample */
+	int32 CollisionStride = 1;
+	FVector ComponentScale = FVector::OneVector;
+	/** The current collision of the component, the new collision is only generated if it differs */
+	TSharedPtr<const FRuntimeLandscapeCollisionData, ESPMode::ThreadSafe> PreviousCollision;
+	/** The generated collision, empty if the current collision is up to date */
+	TSharedPtr<const FRuntimeLandscapeCollisionData, ESPMode::ThreadSafe> Collision;
+
+	/**
+	 * Set for batch rebuilds, the rebuild threads start the next stage themselves without waiting for the game thread
+	 * Notified once all stages of the job are done
+	 */
+	TSharedPtr<FRuntimeLandscapeBatchProgress, ESPMode::ThreadSafe> BatchProgress;
+
+	// Output data
+	/** The vertices inside a hole, generated from the layers by the vertex worker */
+	TSet<int32> VerticesInHole;
+	/** Heights with all layers applied and the generated data */
+	FRuntimeLandscapeRebuildBuffer Buffer;
+
+	std::atomic<int32> ActiveRunners = 0;
+
+	/** Returns true if the component was dirtied after the job was created. Thread safe */
+	FORCEINLINE bool IsStale() const { return GenerationCounter->Get() != Generation; }
+	FORCEINLINE int32 GetVertexAmountX() const { return ComponentResolution.X + 1; }
+	FORCEINLINE float GetHeight(int32 VertexIndex) const
+	{
+		return Buffer.HeightValues.IsEmpty() ? BaseHeights->Get(VertexIndex) : Buffer.HeightValues[VertexIndex];
+	}
+	FORCEINLINE void NotifyRunnerFinished()
+	{
+		// batch jobs only run out of runners once the last stage is done
+		FRuntimeLandscapeBatchProgress* Progress = BatchProgress.Get();
+		if (--ActiveRunners == 0 && Progress)
+		{
+			Progress->NotifyComponentFinished();
+		}
+	}
+};
+
+typedef TSharedPtr<FRuntimeLandscapeRebuildJob, ESPMode::ThreadSafe> FRuntimeLandscapeRebuildJobPtr;
+
+/**
+ * The steps to apply a finished rebuild on the game thread
+ * They are applied one after another, so the work can be spread over multiple frames
+ */
+enum ERuntimeLandscapeApplyStep : uint8
+{
+	/** Also starts cooking the triangle mesh collision asynchronously, if the heightfield collision is not used */
+	RLAS_Mesh,
+	RLAS_GatherGrass,
+	/** Applied once for every grass mesh */
+	RLAS_Grass,
+	/** Applies the heightfield collision, after the visuals so they are not delayed by it */
+	RLAS_Collision,
+	RLAS_Navigation,
+	RLAS_Done
+};
+
+/**
+ * Progress of applying a finished rebuild
+ */
+struct FRuntimeLandscapeApplyState
+{
+	ERuntimeLandscapeApplyStep Step = RLAS_Mesh;
+	/** All grass instances of the component, grouped by mesh */
+	TArray<FLandscapeGrassVertexData> GrassPerMesh;
+	int32 GrassMeshIndex = 0;
+};
+
 UCLASS(Hidden)
 /**
- * Manages threads for rebuilding the landscape
+ * Creates and applies the rebuild jobs of a single landscape
+ * The jobs are scheduled by the URuntimeLandscapeRebuildSubsystem, which is shared by all landscapes
  */
 class RUNTIMEEDITABLELANDSCAPE_API URuntimeLandscapeRebuildManager : public UActorComponent
 {
 	GENERATED_BODY()
 
-	friend class FGenerateVerticesWorker;
-	friend class FGenerateAdditionalVertexDataWorker;
+	friend class URuntimeLandscapeRebuildSubsystem;
 
 public:
-	URuntimeLandscapeRebuildManager();
 	void QueueRebuild(URuntimeLandscapeComponent* ComponentToRebuild);
-	FORCEINLINE FQueuedThreadPool* GetThreadPool() const { return ThreadPool; }
-
-	FORCEINLINE void NotifyRunnerFinished(const FGenerateAdditionalVertexDataWorker* FinishedRunner)
-	{
-		--ActiveRunners;
-	}
-
-	FORCEINLINE void NotifyRunnerFinished(const FGenerateVerticesWorker* FinishedRunner)
-	{
-		--ActiveRunners;
-	}
-
-	TArray<int32> GenerateTriangleArray(const TSet<int32>* HoleIndices) const;
+	/** Frees the buffers kept for reuse, they are allocated again by the next rebuild */
+	void TrimSpareBuffers() { SpareBuffers.Empty(); }
+	/** The memory used by the buffers kept for reuse and the shared triangles */
+	SIZE_T GetSpareBufferSize() const;
+
+	/** 16 bit indices limit the vertices of a single component */
+	static constexpr int32 MaxVerticesPerComponent = MAX_uint16 + 1;
+
+	/** Thread safe, the triangles of a component with the holes left out */
+	static FRuntimeLandscapeIndexArray GenerateTriangleArray(const FIntVector2& ComponentResolution,
+	                                                         const TSet<int32>* HoleIndices);
+	/**
+	 * Triangulates the vertices of the job with a restricted quadtree, flat nodes are merged
+	 * Merged nodes are fanned around their center, so they connect to the vertices of smaller neighbours without cracks
+	 */
+	static void GenerateAdaptiveTriangleArray(const FRuntimeLandscapeRebuildJob& Job,
+	                                          FRuntimeLandscapeIndexArray& OutTriangles);
+	/**
+	 * Queues the runners of the RLRS_BuildAdditionalData stage and adds them to the ActiveRunners of the job
+	 * A runner for every vertex row and the collision runner, if the job builds the heightfield collision
+	 * Thread safe, batch rebuilds start the stage from the rebuild threads
+	 */
+	static void QueueAdditionalDataStage(const FRuntimeLandscapeRebuildJobPtr& Job, FQueuedThreadPool* ThreadPool);
 
 private:
-	UPROPERTY(VisibleAnywhere)
-	URuntimeLandscapeComponent* CurrentComponent = nullptr;
 	UPROPERTY(VisibleAnywhere)
 	TObjectPtr<ARuntimeLandscape> Landscape;
 	UPROPERTY(VisibleAnywhere)
 	FGenerationDataCache GenerationDataCache;
-	UPROPERTY(VisibleAnywhere)
-	FRuntimeLandscapeRebuildBuffer DataBuffer;
-	UPROPERTY(VisibleAnywhere)
-	TArray<URuntimeLandscapeComponent*> RebuildQueue;
 
-	FQueuedThreadPool* ThreadPool;
-	FGenerateVerticesWorker* VertexRunner;
-	TArray<FGenerateAdditionalVertexDataWorker*> AdditionalDataRunners;
-	std::atomic<int32> ActiveRunners;
+	/** Buffers of finished jobs, reused so the buffers don't have to be reallocated for every rebuild */
+	TArray<FRuntimeLandscapeRebuildBuffer> SpareBuffers;
+	/** Immutable, so it is shared by all jobs without copying */
+	FRuntimeLandscapeSharedIndicesPtr SharedTriangles;
 
 	void Initialize()
 	{
-		if (AdditionalDataRunners.IsEmpty())
-		{
-			Landscape = Cast<ARuntimeLandscape>(GetOwner());
-			check(Landscape);
+		Landscape = Cast<ARuntimeLandscape>(GetOwner());
+		check(Landscape);
 
-			InitializeBuffer();
-			InitializeGenerationCache();
-			InitializeRunners();
-		}
+		InitializeGenerationCache();
 	}
 
 	void InitializeGenerationCache();
-	void InitializeRunners();
-	void InitializeBuffer();
-
-	/** 1st step: Rebuild vertex data on a single thread, since this is relatively fast */
-	void StartRebuild();
-	/** 2nd step: Rebuild additional data on multiple threads */
-	void StartGenerateAdditionalData();
-
-	void RebuildNextInQueue()
-	{
-		if (RebuildQueue.IsEmpty())
-		{
-			CurrentComponent = nullptr;
-			SetComponentTickEnabled(false);
-		}
-		else
-		{
-			CurrentComponent = RebuildQueue.Pop();
-			StartRebuild();
-		}
-	}
-
-	void CancelRebuild()
-	{
-		CurrentComponent = nullptr;
-		ActiveRunners = 0;
-		SetComponentTickEnabled(false);
-	}
+	void InitializeBuffer(FRuntimeLandscapeRebuildBuffer& OutBuffer) const;
 
-	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType,
-	                           FActorComponentTickFunction* ThisTickFunction) override;
+	/** Captures everything the rebuild threads need to know about the component, returns nullptr if it has no valid data */
+	FRuntimeLandscapeRebuildJobPtr CreateRebuildJob(URuntimeLandscapeComponent* Component);
+	/** Keeps the buffer of a job that is no longer processed for the next rebuild */
+	void RecycleJob(FRuntimeLandscapeRebuildJobPtr& Job);
 };
@@ -0,0 +1,238 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RuntimeLandscapeEditHandle.h"
+#include "Containers/Queue.h"
+#include "RuntimeLandscapeRebuildManager.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RuntimeLandscapeRebuildSubsystem.generated.h"
+
+class URuntimeLandscapeComponent;
+struct FRuntimeLandscapeMemoryUsage;
+
+/**
+ * A component that is waiting to be rebuilt
+ */
+struct FRuntimeLandscapeRebuildRequest
+{
+	TWeakObjectPtr<URuntimeLandscapeComponent> Component;
+	/** Stays valid when the component is destroyed, to remove it from the queued components */
+	TObjectKey<URuntimeLandscapeComponent> ComponentKey;
+	/** Lower values are rebuilt first */
+	float Priority = 0.0f;
+	/** Keeps requests with the same priority in order */
+	uint64 SequenceNumber = 0;
+
+	bool operator<(const FRuntimeLandscapeRebuildRequest& Other) const
+	{
+		return Priority == Other.Priority ? SequenceNumber < Other.SequenceNumber : Priority < Other.Priority;
+	}
+};
+
+/**
+ * A rebuild that was requested from another thread and waits to be picked up by the game thread
+ */
+struct FRuntimeLandscapePendingRequest
+{
+	TWeakObjectPtr<URuntimeLandscapeComponent> Component;
+	/** Keeps the requested flag alive, even if the component is destroyed in the meantime */
+	TSharedPtr<FRuntimeLandscapeRebuildGeneration, ESPMode::ThreadSafe> Generation;
+};
+
+/**
+ * The view of a local player, used to prioritize, stream and select the LODs of the components
+ */
+struct FRuntimeLandscapeLocalView
+{
+	FVector Location = FVector::ZeroVector;
+	/** Tangent of half the field of view */
+	float FOVScale = 1.0f;
+};
+
+/**
+ * A component that is currently rebuilt by the rebuild threads
+ */
+struct FRuntimeLandscapeActiveRebuild
+{
+	TWeakObjectPtr<URuntimeLandscapeComponent> Component;
+	FRuntimeLandscapeRebuildJobPtr Job;
+	/** Progress of applying the results once the threads are done */
+	FRuntimeLandscapeApplyState ApplyState;
+};
+
+UCLASS()
+/**
+ * Schedules the component rebuilds of all runtime landscapes in the world
+ * Owns the priority queue and limits how many components are rebuilt at the same time,
+ * the rebuild threads are shared by all worlds (see FRuntimeEditableLandscapeModule::GetRebuildThreadPool)
+ * The streaming and LODs, the memory budget and the navigation batches are in their own source files
+ */
+class RUNTIMEEDITABLELANDSCAPE_API URuntimeLandscapeRebuildSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Queues a rebuild, components that are already queued are not added again */
+	void QueueRebuild(URuntimeLandscapeComponent* ComponentToRebuild);
+	/**
+	 * Requests a rebuild from any thread, the request is picked up by the game thread on the next tick
+	 * Requests for the same component are only queued once until they are picked up
+	 */
+	void QueueRebuildFromAnyThread(URuntimeLandscapeComponent* ComponentToRebuild);
+
+	/** Returns true if the component is queued or currently rebuilt */
+	bool IsRebuildPending(const URuntimeLandscapeComponent* Component) const
+	{
+		return QueuedComponents.Contains(Component) || IsRebuilding(Component);
+	}
+
+	/** Returns true if the component is currently rebuilt or its results are applied */
+	bool IsRebuilding(const URuntimeLandscapeComponent* Component) const
+	{
+		auto IsComponent = [Component](const FRuntimeLandscapeActiveRebuild& Rebuild)
+		{
+			return Rebuild.Component.Get() == Component;
+		};
+		return ActiveRebuilds.ContainsByPredicate(IsComponent) || ApplyQueue.ContainsByPredicate(IsComponent);
+	}
+
+	/**
+	 * Executes the callback once the edit is visible on all affected components
+	 * If the edit is already complete, the callback is executed immediately
+	 */
+	void NotifyWhenComplete(const FRuntimeLandscapeEditHandle& EditHandle, FSimpleDelegate Callback);
+
+	/**
+	 * Rebuilds all queued components at once on the rebuild threads, ignoring the concurrency limit
+	 * The stages of every component are chained on the rebuild threads, without waiting for the game thread
+	 * @param Landscape Only rebuild the components of this landscape, all landscapes if nullptr
+	 * @return The amount of components that are rebuilt
+	 */
+	int32 StartBatchRebuild(const ARuntimeLandscape* Landscape = nullptr);
+	/** Returns true if there are batch rebuilds that are not finished by the worker threads */
+	bool IsBatchRebuilding() const;
+	/** The progress of the batch rebuilds on the worker threads between 0 and 1 */
+	float GetBatchProgress() const;
+	/**
+	 * Blocks until all batch rebuilds are finished and applies them right away
+	 * Sleeps until the next component is finished by the rebuild threads
+	 * @param OnProgress Called regularly with the current progress, i.e. to update a progress bar
+	 */
+	void WaitForBatchRebuild(TFunctionRef<void(float Progress)> OnProgress);
+
+	/**
+	 * Updates the component in the navigation octree with the next navigation batch
+	 * Dirties the full bounds of the component, only used if its geometry can't be gathered lazily
+	 */
+	void QueueNavigationUpdate(UPrimitiveComponent* Component);
+	/** Rebuilds the navigation in the area with the next navigation batch */
+	void QueueNavigationDirtyArea(const FBox& DirtyArea);
+	/** Submits the queued navigation updates as one batch, overlapping areas are merged */
+	void FlushNavigationUpdates();
+
+	/** Adds the memory used by the rebuilds that are in flight */
+	void GetMemoryUsage(FRuntimeLandscapeMemoryUsage& OutUsage) const;
+	/**
+	 * Logs the memory used by all runtime landscapes in the world
+	 * @param bIncludeComponents Also log the memory used by every single component
+	 */
+	void LogMemoryReport(bool bIncludeComponents) const;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickableInEditor() const override { return true; }
+	virtual void Deinitialize() override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override
+	{
+		return WorldType == EWorldType::Game || WorldType == EWorldType::PIE || WorldType == EWorldType::Editor;
+	}
+
+private:
+	/** Requests from other threads */
+	TQueue<FRuntimeLandscapePendingRequest, EQueueMode::Mpsc> PendingRequests;
+	/** Heap of the components waiting to be rebuilt */
+	TArray<FRuntimeLandscapeRebuildRequest> RebuildQueue;
+	/** The components in the RebuildQueue, to avoid queueing them twice */
+	TSet<TObjectKey<URuntimeLandscapeComponent>> QueuedComponents;
+	TArray<FRuntimeLandscapeActiveRebuild> ActiveRebuilds;
+	/** Rebuilds that are finished by the threads and wait to be applied on the game thread */
+	TArray<FRuntimeLandscapeActiveRebuild> ApplyQueue;
+	uint64 NextSequenceNumber = 0;
+	TSharedPtr<FRuntimeLandscapeBatchProgress, ESPMode::ThreadSafe> BatchProgress;
+	/** Callbacks that wait for edits to complete */
+	TArray<TPair<FRuntimeLandscapeEditHandle, FSimpleDelegate>> EditCallbacks;
+	/** Components that were rebuilt recently and keep their CPU side data uncompressed */
+	TSet<TWeakObjectPtr<URuntimeLandscapeComponent>> WarmComponents;
+	double NextMemoryUpdateTime = 0.0;
+	/** Components that are updated in the navigation octree with the next navigation batch */
+	TSet<TWeakObjectPtr<UPrimitiveComponent>> PendingNavigationComponents;
+	/** Areas that are rebuilt with the next navigation batch */
+	TArray<FBox> PendingNavigationAreas;
+	double NextNavigationUpdateTime = 0.0;
+	/** The components whose LOD is checked, one after another */
+	TArray<TWeakObjectPtr<URuntimeLandscapeComponent>> LODComponents;
+	int32 NextLODComponent = 0;
+	/** Components that have to switch their LOD, with their screen size */
+	TMap<TWeakObjectPtr<URuntimeLandscapeComponent>, float> PendingLODChanges;
+	/** Components whose LOD mesh is generated on the rebuild threads, swapped in once it is done */
+	TArray<TWeakObjectPtr<URuntimeLandscapeComponent>> ActiveLODBuilds;
+	/** Only warn once when the budget is exceeded */
+	bool bIsOverBudget = false;
+	/** The views of the local players, gathered once per tick. Empty without players, i.e. in the editor */
+	TArray<FRuntimeLandscapeLocalView, TInlineAllocator<4>> LocalViews;
+
+	/** Updates the LocalViews from the local player controllers */
+	void GatherLocalViews();
+	/** Moves the requests from other threads to the RebuildQueue */
+	void DrainPendingRequests();
+	/** Lower values are rebuilt first, components close to the players are preferred */
+	float CalculatePriority(const URuntimeLandscapeComponent* Component) const;
+
+	/** Starts rebuilding queued components until the concurrency limit is reached */
+	void StartQueuedRebuilds();
+	/** 1st step: Rebuild vertex data on a single thread, since this is relatively fast */
+	bool StartRebuild(FRuntimeLandscapeActiveRebuild& Rebuild);
+	/** 2nd step: Rebuild additional data on multiple threads */
+	void StartGenerateAdditionalData(FRuntimeLandscapeActiveRebuild& Rebuild);
+	/** Moves rebuilds that are finished by the threads to the ApplyQueue */
+	void UpdateActiveRebuilds();
+	/**
+	 * Moves the rebuild on to the next step if the threads are done
+	 * @return true if the threads are finished with the rebuild and it can be removed
+	 */
+	bool UpdateActiveRebuild(FRuntimeLandscapeActiveRebuild& Rebuild);
+	/** Applies finished rebuilds step by step until the budget is used up */
+	void ApplyFinishedRebuilds(double BudgetSeconds);
+	/** Executes the callbacks of all edits that are complete */
+	void NotifyCompletedEdits();
+	/** Compresses the cold components, limited by the RuntimeLandscape.Memory console variables */
+	void UpdateColdComponents();
+	/**
+	 * Compresses the data of components that were not edited for a while
+	 * @param ColdSeconds		The time since the last edit after which a component is cold
+	 * @param MaxCompressions	The maximum amount of components to compress
+	 */
+	void CompressColdComponents(double ColdSeconds, int32 MaxCompressions);
+	/** Streams components in and out based on their distance to the local players */
+	void UpdateStreaming();
+	/**
+	 * Selects the LOD of the components based on their screen size, a few components are checked every frame
+	 * The LOD meshes are generated on the rebuild threads, independent of the rebuild queue, and swapped in once done
+	 */
+	void UpdateLODs();
+	/** Submits the queued navigation updates once per navigation update interval */
+	void UpdateNavigation();
+	/** Updates the memory stats and enforces the memory budget, once per update interval */
+	void UpdateMemoryUsage();
+	/** Calculates the memory used by all runtime landscapes in the world, including the rebuilds in flight */
+	FRuntimeLandscapeMemoryUsage CalculateMemoryUsage() const;
+	/**
+	 * Frees caches and evicts the grass of the components furthest away until the usage is within the budget
+	 * Restores evicted grass once there is enough memory again
+	 */
+	void EnforceMemoryBudget(FRuntimeLandscapeMemoryUsage& Usage, SIZE_T BudgetBytes);
+};
@@ -43,6 +43,8 @@ public class RuntimeEditableLandscape : ModuleRules
 			{
 				"CoreUObject",
 				"Engine",
+				"ImageWrapper",
+				"PhysicsCore",
 				"Slate",
 				"SlateCore"
 				// ... add private dependencies that you statically link with here ...	